@@ -351,7 +351,7 @@ static const char BrunoAceFont_compressed_data_base85[47350+1] =
     "2$Uk*YR'm*sQKX-+AtmN*pukMlb;Y$]2`r?in?9&.8YY#_Z/I$u2`9`e.Z>#'5YY#xH@U)vsLfL)GOR-LOkn-l_u3+Iu,thD`$Z?lN]'/oQcf(x<]8%77WM-lICO(DPB(+oO)a%>jdV%"
     "..Lb*%45B$0e?K)mS###R)QIOQ$%##";
 
-static ImFont *AddBrunoAceFont(double scale_factor)
+static ImFont *AddBrunoAceFont(ImFontAtlas* atlas, double scale_factor)
 {
     ImFontConfig config;
     config.OversampleH = 1;
@@ -368,7 +368,7 @@ static ImFont *AddBrunoAceFont(double scale_factor)
         *dst++ = *name++;
     *dst = '\0';
 
-    return ImGui::GetIO().Fonts->AddFontFromMemoryCompressedBase85TTF(BrunoAceFont_compressed_data_base85, config.SizePixels, &config);
+    return atlas->AddFontFromMemoryCompressedBase85TTF(BrunoAceFont_compressed_data_base85, config.SizePixels, &config);
 }
 
 #endif
@@ -341,7 +341,7 @@ static const char BrunoAceSCFont_compressed_data_base85[46040+1] =
     "D6/#GfKYW/XHuY#B%u.#$va^#,BlY#HB5'of_Af+(a)b<_>piLKRlcMGOtV7hm4Z-/SUY:dlor^AA)9/ZPA^+G(EM-B(EAJY)I@H%x7q(n=(SK*Csc<AU>-+]Ks$#dqVM/6A,##]1SfL"
     "hW0DMu=Gx#&)###fTt(M]JN,#6.F6jK=D6jt`/.M6(^fLm>Ju-JkZgL,[s$#-;.?$tFtHZF.[m<<1'6*?CpGP>Z/],t-UN(9`9p7vDpr.+0b$#HgTOJws@##";
 
-static ImFont *AddBrunoAceSCFont(double scale_factor)
+static ImFont *AddBrunoAceSCFont(ImFontAtlas* atlas, double scale_factor)
 {
     ImFontConfig config;
     config.OversampleH = 1;
@@ -358,7 +358,7 @@ static ImFont *AddBrunoAceSCFont(double scale_factor)
         *dst++ = *name++;
     *dst = '\0';
 
-    return ImGui::GetIO().Fonts->AddFontFromMemoryCompressedBase85TTF(BrunoAceSCFont_compressed_data_base85, config.SizePixels, &config);
+    return atlas->AddFontFromMemoryCompressedBase85TTF(BrunoAceSCFont_compressed_data_base85, config.SizePixels, &config);
 }
 
 #endif
@@ -32,7 +32,7 @@
 #define DISTRHO_UI_CUSTOM_WIDGET_TYPE DGL_NAMESPACE::ImGuiTopLevelWidget
 #define DISTRHO_UI_URI DISTRHO_PLUGIN_URI "#UI"
 #define DISTRHO_UI_DEFAULT_WIDTH       1310
-#define DISTRHO_UI_DEFAULT_HEIGHT      555
+#define DISTRHO_UI_DEFAULT_HEIGHT      625
 #define DISTRHO_PLUGIN_IS_RT_SAFE      1
 #define DISTRHO_PLUGIN_NUM_INPUTS      0
 #define DISTRHO_PLUGIN_NUM_OUTPUTS     0
@@ -40,6 +40,7 @@
 #define DISTRHO_PLUGIN_WANT_MIDI_OUTPUT 1
 #define DISTRHO_PLUGIN_WANT_STATE      1
 #define DISTRHO_PLUGIN_WANT_TIMEPOS    1
+#define DISTRHO_PLUGIN_WANT_DIRECT_ACCESS 1
 #define DISTRHO_UI_FILE_BROWSER        1
 #define DISTRHO_UI_USER_RESIZABLE      1
 
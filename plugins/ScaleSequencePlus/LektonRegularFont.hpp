@@ -413,7 +413,7 @@ static const char LektonRegularFont_compressed_data_base85[56115+1] =
     "P@%t72F=HE1UbWO*i),D@^V]-R(_N`dxna96XTf3?0/4ilg=g$uU$##qjY0j$4.5/-mc;-?*I#Pb+CaBY@e2E&kakEtc_+;;0n3;c6h/NF6'G;.u3Q(>JARCBAH2=UaX@I3oGeux>9Z9"
     "&)FE#IqlC7X].<87pOvIFev.:VQ,N`pPGqEhW:Z7._GZ84F]Hl1CkR<cGfvOCN7&GN`K_7e(I[&K&c[BN(7*>Q-+G#KOU*n)n'&NL&XJ(dZ34S[cC7#";
 
-static ImFont *AddLektonRegularFont(double scale_factor)
+static ImFont *AddLektonRegularFont(ImFontAtlas* atlas, double scale_factor)
 {
     ImFontConfig config;
     config.OversampleH = 1;
@@ -430,7 +430,7 @@ static ImFont *AddLektonRegularFont(double scale_factor)
         *dst++ = *name++;
     *dst = '\0';
 
-    return ImGui::GetIO().Fonts->AddFontFromMemoryCompressedBase85TTF(LektonRegularFont_compressed_data_base85, config.SizePixels, &config);
+    return atlas->AddFontFromMemoryCompressedBase85TTF(LektonRegularFont_compressed_data_base85, config.SizePixels, &config);
 }
 
 #endif
@@ -2,6 +2,9 @@
 #define SCALESEQUENCE_PLUS_CONTROLS_HPP
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 
 template <class T>
 T limit (const T x, const T min, const T max)
@@ -48,9 +51,105 @@ enum Parameters {
     kParameterOffset     = 35,
     kParameterLoopPoint  = 36,
     kParameterCurrentStep = 37,
-    kParameterCount      = 38
+    kParameterMultiChannel = 38,
+    kParameterChannel1   = 39,
+    kParameterChannel2   = 40,
+    kParameterChannel3   = 41,
+    kParameterChannel4   = 42,
+    kParameterChannel5   = 43,
+    kParameterChannel6   = 44,
+    kParameterChannel7   = 45,
+    kParameterChannel8   = 46,
+    kParameterChannel9   = 47,
+    kParameterChannel10  = 48,
+    kParameterChannel11  = 49,
+    kParameterChannel12  = 50,
+    kParameterChannel13  = 51,
+    kParameterChannel14  = 52,
+    kParameterChannel15  = 53,
+    kParameterChannel16  = 54,
+    kParameterMasterStatus = 55,
+    kParameterBypass     = 56,
+    kParameterSysExMode  = 57,
+    kParameterSysExDinRate = 58,
+    kParameterMpeOutput  = 59,
+    kParameterMpeBendRange = 60,
+    kParameterStepReset  = 61,
+    kParameterLanes      = 62,
+    kParameterLaneCombine = 63,
+    kParameterLane2      = 64,  // lanes 2 to 4 each have kLaneParameterCount parameters, see LaneParameters
+    kParameterLane3      = 99,
+    kParameterLane4      = 134,
+    kParameterCount      = 169
 };
 
+// Step types, the values of kParameterMeasure
+enum StepModes {
+    kStepBeats     = 0,
+    kStepBars      = 1,
+    kStepMidiNote  = 2,
+    kStepModeCount = 3
+};
+
+// When MIDI Note stepping goes back to the start of the sequence, the values of kParameterStepReset.
+// Beats and bars always follow the host position.
+enum StepResets {
+    kStepResetNever  = 0,
+    kStepResetOnStop = 1,
+    kStepResetOnJump = 2  // on stop, start, seek and loop
+};
+
+// How the lanes make up the scale of the sequence, the values of kParameterLaneCombine
+enum LaneCombines {
+    kCombinePriority    = 0, // the highest lane that has a scale on its step
+    kCombineLastChanged = 1  // the lane whose step started last, of those that have a scale on it
+};
+
+enum SysExModes {
+    kSysExOff        = 0,
+    kSysExSingleNote = 1,
+    kSysExBulkDump   = 2
+};
+
+// Number of steps in the sequence, and how many of them the UI shows per row
+static const int32_t kNumSteps = 32;
+static const int32_t kStepsPerRow = 32;
+
+// Number of MIDI channels that can be tuned individually in multi-channel mode
+static const int32_t kNumChannels = 16;
+
+// Number of sequencer lanes. Lane 1 is the sequence above, lanes 2 to 4 have their own step length, loop point
+// and steps, with steps that can also be off.
+static const int32_t kNumLanes = 4;
+
+// The parameters of each of lanes 2 to 4, from its kParameterLane* on. Lane 1 uses kParameterMultiplier,
+// kParameterLoopPoint, kParameterCurrentStep and kParameterStep1 to kParameterStep32 in their place.
+enum LaneParameters {
+    kLaneMultiplier     = 0,
+    kLaneLoopPoint      = 1,
+    kLaneCurrentStep    = 2,
+    kLaneStep1          = 3,
+    kLaneParameterCount = kLaneStep1 + kNumSteps
+};
+
+static_assert(kParameterLane3 == kParameterLane2 + kLaneParameterCount && kParameterLane4 == kParameterLane3 + kLaneParameterCount
+              && kParameterCount == kParameterLane4 + kLaneParameterCount, "lane parameter blocks must be consecutive");
+
+// Parameter @a which (LaneParameters) of lane @a lane, counting lanes from 0
+static constexpr uint32_t laneParameter(int32_t lane, int32_t which)
+{
+    if (lane != 0)
+        return kParameterLane2 + (lane - 1) * kLaneParameterCount + which;
+
+    switch (which)
+    {
+    case kLaneMultiplier:  return kParameterMultiplier;
+    case kLaneLoopPoint:   return kParameterLoopPoint;
+    case kLaneCurrentStep: return kParameterCurrentStep;
+    default:               return kParameterStep1 + (which - kLaneStep1);
+    }
+}
+
 enum States {
     kStateFileSCL1 = 0,
     kStateFileSCL2 = 1,
@@ -71,89 +170,327 @@ enum States {
     kStateCount    = 16
 };
 
-static const std::array<std::pair<float, float>, kParameterCount> controlLimits =
-{{
-    {0.0f, 2.0f},    //kParameterMeasure
-	{1.0f, 12.0f},   //kParameterMultiplier,
-	{1.0f, 100.0f}, //kParameterScaleGlide
-    {1.0f, 8.0f},    //kParameterStep1,
-    {1.0f, 8.0f},    //kParameterStep2,
-    {1.0f, 8.0f},    //kParameterStep3,
-    {1.0f, 8.0f},    //kParameterStep4,
-    {1.0f, 8.0f},    //kParameterStep5,
-    {1.0f, 8.0f},    //kParameterStep6,
-    {1.0f, 8.0f},    //kParameterStep7,
-    {1.0f, 8.0f},    //kParameterStep8,
-    {1.0f, 8.0f},    //kParameterStep9,
-    {1.0f, 8.0f},    //kParameterStep10,
-    {1.0f, 8.0f},    //kParameterStep11,
-    {1.0f, 8.0f},    //kParameterStep12,
-    {1.0f, 8.0f},    //kParameterStep13,
-    {1.0f, 8.0f},    //kParameterStep14,
-    {1.0f, 8.0f},    //kParameterStep15,
-    {1.0f, 8.0f},    //kParameterStep16,
-    {1.0f, 8.0f},    //kParameterStep17,
-    {1.0f, 8.0f},    //kParameterStep18,
-    {1.0f, 8.0f},    //kParameterStep19,
-    {1.0f, 8.0f},    //kParameterStep20,
-    {1.0f, 8.0f},    //kParameterStep21,
-    {1.0f, 8.0f},    //kParameterStep22,
-    {1.0f, 8.0f},    //kParameterStep23,
-    {1.0f, 8.0f},    //kParameterStep24,
-    {1.0f, 8.0f},    //kParameterStep25,
-    {1.0f, 8.0f},    //kParameterStep26,
-    {1.0f, 8.0f},    //kParameterStep27,
-    {1.0f, 8.0f},    //kParameterStep28,
-    {1.0f, 8.0f},    //kParameterStep29,
-    {1.0f, 8.0f},    //kParameterStep30,
-    {1.0f, 8.0f},    //kParameterStep31,
-    {1.0f, 8.0f},    //kParameterStep32,
-    {-1.0f, 1.0f},   //kParameterOffset
-    {2.0f, 32.0f},    //kParameterLoopPoint
-    {0.0f, 1.0f}    //kParameterCurrentStep
-}};
-
-static const float ParameterDefaults[kParameterCount] = {
-	0.0f, //kParameterMeasure
-	1.0f, //kParameterMultiplier,
-	1.0f, //kParameterScaleGlide
-    1.0f, //kParameterStep1,
-    1.0f, //kParameterStep2,
-    1.0f, //kParameterStep3,
-    1.0f, //kParameterStep4,
-    1.0f, //kParameterStep5,
-    1.0f, //kParameterStep6,
-    1.0f, //kParameterStep7,
-    1.0f, //kParameterStep8,
-    1.0f, //kParameterStep9,
-    1.0f, //kParameterStep10,
-    1.0f, //kParameterStep11,
-    1.0f, //kParameterStep12,
-    1.0f, //kParameterStep13,
-    1.0f, //kParameterStep14,
-    1.0f, //kParameterStep15,
-    1.0f, //kParameterStep16,
-    1.0f, //kParameterStep17,
-    1.0f, //kParameterStep18,
-    1.0f, //kParameterStep19,
-    1.0f, //kParameterStep20,
-    1.0f, //kParameterStep21,
-    1.0f, //kParameterStep22,
-    1.0f, //kParameterStep23,
-    1.0f, //kParameterStep24,
-    1.0f, //kParameterStep25,
-    1.0f, //kParameterStep26,
-    1.0f, //kParameterStep27,
-    1.0f, //kParameterStep28,
-    1.0f, //kParameterStep29,
-    1.0f, //kParameterStep30,
-    1.0f, //kParameterStep31,
-    1.0f, //kParameterStep32,
-    0.0f, //kParameterOffset
-    32.0f, //kParameterLoopPoint
-    1.0f //kParameterCurrentStep (default not used)
-	
+// --------------------------------------------------------------------------------------------------------------------
+// Parameter and state descriptions. Everything the plugin tells the host, the UI and the tools in utils/ use comes
+// from kParameterDescriptors and kStateDescriptors, built at compile time, so growing the steps, channels or scale
+// slots only means changing the counts above.
+
+// Parameter flags, turned into DPF's kParameterIs* hints by the plugin
+enum ParameterFlags {
+    kFlagAutomatable = 1 << 0,
+    kFlagBoolean     = 1 << 1,
+    kFlagInteger     = 1 << 2,
+    kFlagLogarithmic = 1 << 3,
+    kFlagOutput      = 1 << 4,
+    kFlagBypass      = 1 << 5  // the host's bypass; the plugin uses DPF's bypass designation for it
+};
+
+// Value lists for parameters the host shows as a choice, values counting from 0
+enum ParameterEnumerations {
+    kEnumNone        = 0,
+    kEnumMeasure     = 1,
+    kEnumSysExMode   = 2,
+    kEnumScaleChoice = 3,
+    kEnumStepReset   = 4,
+    kEnumLaneCombine = 5,
+    kEnumLaneStep    = 6,
+    kEnumCount       = 7
+};
+
+struct EnumerationDescriptor
+{
+    uint32_t count;
+    const char* labels[13];
+};
+
+static constexpr EnumerationDescriptor kEnumerationDescriptors[kEnumCount] = {
+    { 0, {} },
+    { 3, { "Beats", "Bars", "MIDI Note" } },
+    { 3, { "Off", "Single Note", "Bulk Dump" } },
+    { 13, { "Sequence", "Scale 1", "Scale 2", "Scale 3", "Scale 4", "Scale 5", "Scale 6", "Scale 7", "Scale 8",
+            "Lane 1", "Lane 2", "Lane 3", "Lane 4" } },
+    { 3, { "Never", "On Stop", "On Jump" } },
+    { 2, { "Priority", "Last Changed" } },
+    { 9, { "Off", "Scale 1", "Scale 2", "Scale 3", "Scale 4", "Scale 5", "Scale 6", "Scale 7", "Scale 8" } }
+};
+
+struct ParameterDescriptor
+{
+    char name[24];
+    char symbol[24];
+    const char* unit;
+    uint32_t flags;        // ParameterFlags
+    uint32_t enumeration;  // ParameterEnumerations
+    float min;
+    float max;
+    float def;
 };
 
+struct StateDescriptor
+{
+    char key[16];
+    char label[16];
+};
+
+namespace ControlsDetail {
+
+template <std::size_t N>
+constexpr std::size_t copyText(char (&dst)[N], const char* text)
+{
+    std::size_t length = 0;
+    for (; text[length] != '\0' && length + 1 < N; length++)
+        dst[length] = text[length];
+    dst[length] = '\0';
+    return length;
+}
+
+// Adds @a text to the end of @a dst
+template <std::size_t N>
+constexpr std::size_t appendText(char (&dst)[N], const char* text)
+{
+    std::size_t length = 0;
+    while (dst[length] != '\0')
+        length++;
+    for (; *text != '\0' && length + 1 < N; ++text)
+        dst[length++] = *text;
+    dst[length] = '\0';
+    return length;
+}
+
+// Adds "Step " and 12 to the end of @a dst
+template <std::size_t N>
+constexpr void appendNumberedText(char (&dst)[N], const char* prefix, int32_t number)
+{
+    std::size_t length = appendText(dst, prefix);
+
+    char digits[12] = {};
+    int32_t count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + number % 10);
+        number /= 10;
+    } while (number != 0);
+
+    while (count > 0 && length + 1 < N)
+        dst[length++] = digits[--count];
+    dst[length] = '\0';
+}
+
+// "Step " and 12 make "Step 12"
+template <std::size_t N>
+constexpr void numberedText(char (&dst)[N], const char* prefix, int32_t number)
+{
+    copyText(dst, "");
+    appendNumberedText(dst, prefix, number);
+}
+constexpr ParameterDescriptor parameter(const char* name, const char* symbol, uint32_t flags,
+                                        float min, float max, float def,
+                                        uint32_t enumeration = kEnumNone, const char* unit = "")
+{
+    ParameterDescriptor d {};
+    copyText(d.name, name);
+    copyText(d.symbol, symbol);
+    d.unit = unit;
+    d.flags = flags;
+    d.enumeration = enumeration;
+    d.min = min;
+    d.max = max;
+    d.def = def;
+    return d;
+}
+
+constexpr ParameterDescriptor numberedParameter(const char* name, const char* symbol, int32_t number, uint32_t flags,
+                                                float min, float max, float def, uint32_t enumeration = kEnumNone)
+{
+    ParameterDescriptor d(parameter("", "", flags, min, max, def, enumeration));
+    numberedText(d.name, name, number);
+    numberedText(d.symbol, symbol, number);
+    return d;
+}
+
+// "Lane 2 Loop Point" and "lane2looppoint", or with a @a number above 0, "Lane 2 Step 12" and "lane2step12"
+constexpr ParameterDescriptor laneParameterDescriptor(int32_t lane, const char* name, const char* symbol, int32_t number, uint32_t flags,
+                                                      float min, float max, float def, uint32_t enumeration = kEnumNone)
+{
+    ParameterDescriptor d(numberedParameter("Lane ", "lane", lane + 1, flags, min, max, def, enumeration));
+    if (number > 0)
+    {
+        appendNumberedText(d.name, name, number);
+        appendNumberedText(d.symbol, symbol, number);
+    }
+    else
+    {
+        appendText(d.name, name);
+        appendText(d.symbol, symbol);
+    }
+    return d;
+}
+
+constexpr std::array<ParameterDescriptor, kParameterCount> makeParameterDescriptors()
+{
+    std::array<ParameterDescriptor, kParameterCount> d {};
+
+    d[kParameterMeasure]      = parameter("Measure", "measure", kFlagAutomatable|kFlagInteger, kStepBeats, kStepMidiNote, kStepBeats, kEnumMeasure);
+    d[kParameterMultiplier]   = parameter("Multiplier", "multiplier", kFlagAutomatable|kFlagInteger, 1.0f, 12.0f, 1.0f);
+    d[kParameterScaleGlide]   = parameter("Scale Glide", "scaleGlide", kFlagAutomatable|kFlagLogarithmic, 1.0f, 100.0f, 1.0f);
+
+    for (int32_t step = 0; step < kNumSteps; step++)
+        d[kParameterStep1 + step] = numberedParameter("Step ", "step", step + 1, kFlagAutomatable|kFlagInteger, 1.0f, 8.0f, 1.0f);
+
+    d[kParameterOffset]       = parameter("Offset", "offset", kFlagAutomatable, -1.0f, 1.0f, 0.0f);
+    d[kParameterLoopPoint]    = parameter("Loop Point", "looppoint", kFlagAutomatable|kFlagInteger, 2.0f, 32.0f, 32.0f);
+    // Step number times 1/32. It starts out on 1, the last step, until the sequence starts.
+    d[kParameterCurrentStep]  = parameter("Current Step", "currentstep", kFlagOutput, 0.0f, 1.0f, 1.0f);
+    d[kParameterMultiChannel] = parameter("Multi-Channel", "multichannel", kFlagAutomatable|kFlagBoolean, 0.0f, 1.0f, 0.0f);
+
+    // 0 = follow the sequence, 1 to 8 = a scale, 9 to 12 = follow one lane
+    for (int32_t ch = 0; ch < kNumChannels; ch++)
+        d[kParameterChannel1 + ch] = numberedParameter("Channel ", "channel", ch + 1, kFlagAutomatable|kFlagInteger, 0.0f, 8.0f + kNumLanes, 0.0f, kEnumScaleChoice);
+
+    d[kParameterMasterStatus] = parameter("MTS-ESP Master", "masterstatus", kFlagOutput|kFlagBoolean, 0.0f, 1.0f, 0.0f);
+    d[kParameterBypass]       = parameter("Bypass", "dpf_bypass", kFlagAutomatable|kFlagBoolean|kFlagInteger|kFlagBypass, 0.0f, 1.0f, 0.0f);
+    d[kParameterSysExMode]    = parameter("SysEx Output", "sysexmode", kFlagAutomatable|kFlagInteger, 0.0f, 2.0f, kSysExOff, kEnumSysExMode);
+    d[kParameterSysExDinRate] = parameter("SysEx DIN Rate", "sysexdinrate", kFlagAutomatable|kFlagBoolean, 0.0f, 1.0f, 1.0f);
+    d[kParameterMpeOutput]    = parameter("MPE Output", "mpeoutput", kFlagAutomatable|kFlagBoolean, 0.0f, 1.0f, 0.0f);
+    // 48 is the MPE default for member channels
+    d[kParameterMpeBendRange] = parameter("MPE Bend Range", "mpebendrange", kFlagAutomatable|kFlagInteger, 1.0f, 96.0f, 48.0f, kEnumNone, "semitones");
+    d[kParameterStepReset]    = parameter("Step Reset", "stepreset", kFlagAutomatable|kFlagInteger, kStepResetNever, kStepResetOnJump, kStepResetNever, kEnumStepReset);
+    d[kParameterLanes]        = parameter("Lanes", "lanes", kFlagAutomatable|kFlagInteger, 1.0f, kNumLanes, 1.0f);
+    d[kParameterLaneCombine]  = parameter("Lane Combine", "lanecombine", kFlagAutomatable|kFlagInteger, kCombinePriority, kCombineLastChanged, kCombinePriority, kEnumLaneCombine);
+
+    // Lanes 2 to 4. Their steps start out off, so that a lane changes nothing until it is given scales.
+    for (int32_t lane = 1; lane < kNumLanes; lane++)
+    {
+        d[laneParameter(lane, kLaneMultiplier)]  = laneParameterDescriptor(lane, " Multiplier", "multiplier", 0, kFlagAutomatable|kFlagInteger, 1.0f, 12.0f, 1.0f);
+        d[laneParameter(lane, kLaneLoopPoint)]   = laneParameterDescriptor(lane, " Loop Point", "looppoint", 0, kFlagAutomatable|kFlagInteger, 2.0f, 32.0f, 32.0f);
+        d[laneParameter(lane, kLaneCurrentStep)] = laneParameterDescriptor(lane, " Current Step", "currentstep", 0, kFlagOutput, 0.0f, 1.0f, 1.0f);
+
+        for (int32_t step = 0; step < kNumSteps; step++)
+            d[laneParameter(lane, kLaneStep1 + step)] = laneParameterDescriptor(lane, " Step ", "step", step + 1, kFlagAutomatable|kFlagInteger, 0.0f, 8.0f, 0.0f, kEnumLaneStep);
+    }
+
+    return d;
+}
+
+constexpr std::array<StateDescriptor, kStateCount> makeStateDescriptors()
+{
+    std::array<StateDescriptor, kStateCount> d {};
+
+    for (int32_t slot = 0; slot < 8; slot++)
+    {
+        numberedText(d[kStateFileSCL1 + slot].key, "scl_file_", slot + 1);
+        numberedText(d[kStateFileSCL1 + slot].label, "SCL File ", slot + 1);
+        numberedText(d[kStateFileKBM1 + slot].key, "kbm_file_", slot + 1);
+        numberedText(d[kStateFileKBM1 + slot].label, "KBM File ", slot + 1);
+    }
+
+    return d;
+}
+
+} // namespace ControlsDetail
+
+static constexpr std::array<ParameterDescriptor, kParameterCount> kParameterDescriptors = ControlsDetail::makeParameterDescriptors();
+static constexpr std::array<StateDescriptor, kStateCount> kStateDescriptors = ControlsDetail::makeStateDescriptors();
+
+namespace ControlsDetail {
+
+template <std::size_t... I>
+constexpr std::array<std::pair<float, float>, kParameterCount> makeControlLimits(std::index_sequence<I...>)
+{
+    return {{ { kParameterDescriptors[I].min, kParameterDescriptors[I].max }... }};
+}
+
+template <std::size_t... I>
+constexpr std::array<float, kParameterCount> makeParameterDefaults(std::index_sequence<I...>)
+{
+    return {{ kParameterDescriptors[I].def... }};
+}
+
+constexpr bool everyParameterDescribed()
+{
+    for (const ParameterDescriptor& d : kParameterDescriptors)
+        if (d.symbol[0] == '\0' || d.max < d.min || d.def < d.min || d.def > d.max)
+            return false;
+    return true;
+}
+
+} // namespace ControlsDetail
+
+static_assert(ControlsDetail::everyParameterDescribed(), "every parameter needs a symbol and a default within its range");
+
+// Range and default of each parameter, from kParameterDescriptors
+static constexpr std::array<std::pair<float, float>, kParameterCount> controlLimits =
+    ControlsDetail::makeControlLimits(std::make_index_sequence<kParameterCount>());
+static constexpr std::array<float, kParameterCount> ParameterDefaults =
+    ControlsDetail::makeParameterDefaults(std::make_index_sequence<kParameterCount>());
+
+// --------------------------------------------------------------------------------------------------------------------
+// State key lookup, for setState() and stateChanged(). The keys are hashed into a table with a seed picked at compile
+// time so that no two keys share a slot (a perfect hash), so a lookup is one hash and one string compare.
+
+namespace ControlsDetail {
+
+static constexpr uint32_t kStateKeySlots = 32;
+
+constexpr uint32_t stateKeyHash(const char* key, uint32_t seed)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u ^ seed;
+    for (; *key != '\0'; ++key)
+        hash = (hash ^ static_cast<uint8_t>(*key)) * 16777619u;
+    return hash % kStateKeySlots;
+}
+
+constexpr bool sameText(const char* a, const char* b)
+{
+    for (; *a != '\0' && *a == *b; ++a, ++b) {}
+    return *a == *b;
+}
+
+constexpr uint32_t findStateKeySeed()
+{
+    for (uint32_t seed = 0; seed < 100000; seed++)
+    {
+        bool used[kStateKeySlots] = {};
+        bool collision = false;
+        for (int32_t i = 0; i < kStateCount && !collision; i++)
+        {
+            const uint32_t slot = stateKeyHash(kStateDescriptors[i].key, seed);
+            collision = used[slot];
+            used[slot] = true;
+        }
+        if (!collision)
+            return seed;
+    }
+    return UINT32_MAX;
+}
+
+static constexpr uint32_t kStateKeySeed = findStateKeySeed();
+static_assert(kStateKeySeed != UINT32_MAX, "no perfect hash seed for the state keys, make kStateKeySlots bigger");
+
+constexpr std::array<int8_t, kStateKeySlots> makeStateKeyTable()
+{
+    std::array<int8_t, kStateKeySlots> table {};
+    for (uint32_t slot = 0; slot < kStateKeySlots; slot++)
+        table[slot] = -1;
+    for (int32_t i = 0; i < kStateCount; i++)
+        table[stateKeyHash(kStateDescriptors[i].key, kStateKeySeed)] = static_cast<int8_t>(i);
+    return table;
+}
+
+static constexpr std::array<int8_t, kStateKeySlots> kStateKeyTable = makeStateKeyTable();
+
+} // namespace ControlsDetail
+
+/**
+   The state with key @a key, or kStateCount if there is none.
+ */
+constexpr States stateForKey(const char* key)
+{
+    const int8_t index = ControlsDetail::kStateKeyTable[ControlsDetail::stateKeyHash(key, ControlsDetail::kStateKeySeed)];
+    return index >= 0 && ControlsDetail::sameText(key, kStateDescriptors[index].key) ? static_cast<States>(index) : kStateCount;
+}
+
+static_assert(stateForKey("scl_file_1") == kStateFileSCL1 && stateForKey("kbm_file_8") == kStateFileKBM8
+              && stateForKey("scl_file_9") == kStateCount && stateForKey("") == kStateCount, "state key lookup");
 
 #endif
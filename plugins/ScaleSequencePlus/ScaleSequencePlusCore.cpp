@@ -0,0 +1,1678 @@
+#include "ScaleSequencePlusCore.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -----------------------------------------------------------------------------------------------------------
+
+ScaleSequencePlusCore::ScaleSequencePlusCore(ScaleSequencePlusHost& host)
+    : fHost(host),
+#if SCALESEQUENCE_PLUS_PLUGGABLE_SINK
+      fSink(&fMtsEsp),
+#endif
+      fTunings(new Tunings::Tuning[8]),
+      sample_rate(48000.0),
+      fScaleInfo(new ScaleInfo[1 + 8 * 3]())
+{
+    std::memset(fHot.parameters, 0, sizeof(fHot.parameters));
+
+    // populate fHot.parameters with defaults
+    for (int32_t i = 0; i < kParameterCount; i++)
+    {
+        fHot.parameters[i] = ParameterDefaults[i];
+    }
+
+	fHot.current_scale = 0;
+	fHot.step_mode = static_cast<int32_t>(fHot.parameters[kParameterMeasure]);
+	for (int32_t lane = 0; lane < kNumLanes; lane++)
+	{
+		fHot.lane_steps[lane] = -1;
+		fHot.lane_started[lane] = 0;
+	}
+	fHot.lane_clock = 0;
+	fHot.glide_converged = true;
+
+    //Fill frequency arrays with default frequencies from the first slot
+
+    for (int32_t i = 0; i < 128; i++)
+    {
+        fHot.frequencies[i] = fTunings[0].frequencyForMidiNote(i);
+        fHot.targets[i] = fTunings[0].frequencyForMidiNote(i);
+    }
+    std::memcpy(glide_origin_in_hz, fHot.frequencies, sizeof(glide_origin_in_hz));
+#if SCALESEQUENCE_PLUS_FLOAT_GLIDE
+    fHot.glide_in_float = false;
+    fHot.glide_position = 0.0;
+    std::memset(fHot.glide_offsets, 0, sizeof(fHot.glide_offsets));
+#endif
+
+    // Each channel starts out on the same table, following the sequence
+    for (int32_t ch = 0; ch < kNumChannels; ch++)
+    {
+        std::memcpy(channel_frequencies_in_hz[ch], fHot.frequencies, sizeof(fHot.frequencies));
+        std::memcpy(channel_target_frequencies_in_hz[ch], fHot.frequencies, sizeof(fHot.frequencies));
+        channel_scale[ch] = 0;
+    }
+    channels_enabled = 0;
+    channels_gliding = 0;
+
+    scale_info[0] = &fScaleInfo[0];
+    scale_info_changed.store(false);
+    for (int32_t scale = 1; scale <= 8; scale++)
+    {
+        const uint32_t first = 1 + (scale - 1) * 3;
+        scale_info_written[scale] = first;
+        scale_info_handover[scale].store(first + 1);
+        scale_info_taken[scale] = first + 2;
+        scale_info[scale] = &fScaleInfo[first + 2];
+        updateScaleInfo(scale);
+    }
+    takeScaleInfo();
+    std::memset(note_filter, 0, sizeof(note_filter));
+    note_filter_shared = true;
+    note_filter_dirty = false;
+
+    fHot.is_master = false;
+    fHot.offline_glide = false;
+    fHot.snap_to_target = false;
+    fMasterState.store(kMasterNone);
+    fBypassed.store(fHot.parameters[kParameterBypass] >= 0.5f);
+
+    sysex_mode = kSysExOff;
+    sysex_dirty = false;
+    sysex_bulk_pending = false;
+    sysex_cursor = 0;
+    sysex_budget = 0.0;
+    std::memset(sysex_sent, 0xFF, sizeof(sysex_sent));
+    switch_frame = 0;
+
+    mpe_active = false;
+    mpe_bend_range = static_cast<int32_t>(ParameterDefaults[kParameterMpeBendRange]);
+    resetMpeVoices();
+
+    block_publishes = 0;
+    trace_frame = 0;
+    trace_gliding = false;
+}
+
+ScaleSequencePlusCore::~ScaleSequencePlusCore()
+{
+    deactivate();
+}
+
+/* -----------------------------------------------------------------------------------------------------------
+ * Tuning files */
+
+void ScaleSequencePlusCore::loadScl(int32_t slot, const char* path)
+{
+	Tunings::Tuning* const tn = tuningForScale(slot);
+	if (tn == nullptr)
+		return;
+	if (path == nullptr)
+		path = "";
+
+	loadScl(*tn, path, static_cast<States>(kStateFileSCL1 + slot - 1));
+	updateScaleInfo(slot);
+}
+
+void ScaleSequencePlusCore::loadKbm(int32_t slot, const char* path)
+{
+	Tunings::Tuning* const tn = tuningForScale(slot);
+	if (tn == nullptr)
+		return;
+	if (path == nullptr)
+		path = "";
+
+	loadKbm(*tn, path, static_cast<States>(kStateFileKBM1 + slot - 1));
+	updateScaleInfo(slot);
+}
+
+void ScaleSequencePlusCore::loadScl(Tunings::Tuning & tn, const char* value, States stateId)
+{
+	TuningFileInfo info;
+	readScl(tn, value, info);
+
+	// The whole tuning of the slot has been reset, so the mapping is reported as reset too
+	if (info.pairReset)
+	{
+		TuningFileInfo pair;
+		describeKbm(pair, tn.keyboardMapping, nullptr);
+		fHost.tuningFileInfoChanged(static_cast<States>(stateId + kStateFileKBM1), pair);
+	}
+
+	fHost.tuningFileInfoChanged(stateId, info);
+}
+
+void ScaleSequencePlusCore::loadKbm(Tunings::Tuning & tn, const char* value, States stateId)
+{
+	TuningFileInfo info;
+	readKbm(tn, value, info);
+
+	// The whole tuning of the slot has been reset, so the scale is reported as reset too
+	if (info.pairReset)
+	{
+		TuningFileInfo pair;
+		describeScl(pair, tn.scale, nullptr);
+		fHost.tuningFileInfoChanged(static_cast<States>(stateId - kStateFileKBM1), pair);
+	}
+
+	fHost.tuningFileInfoChanged(stateId, info);
+}
+
+TuningFileInfo ScaleSequencePlusCore::inspectTuningFile(States stateId, const char* path)
+{
+	Tunings::Tuning tn;
+	TuningFileInfo info;
+
+	if (stateId < kStateFileKBM1)
+		readScl(tn, path, info);
+	else
+		readKbm(tn, path, info);
+
+	return info;
+}
+
+void ScaleSequencePlusCore::readScl(Tunings::Tuning & tn, const char* value, TuningFileInfo& info)
+{
+	auto k = tn.keyboardMapping;
+
+	if (endsWith(value, ".scl"))
+	{
+		try
+		{   auto s = Tunings::readSCLFile(value);
+			tn = Tunings::Tuning(s, k);
+			describeScl(info, tn.scale, value);
+			//d_stdout("ScaleSequence-Plus: tuning set to %s", value);
+		}
+		catch (const std::exception& e)
+		{
+			tn = Tunings::Tuning();
+			describeScl(info, tn.scale, nullptr);
+			rejectFile(info, e);
+		}
+	}
+	else
+	{
+		auto s = Tunings::Tuning().scale;
+		tn = Tunings::Tuning(s, k);
+		describeScl(info, tn.scale, nullptr);
+
+		if (value[0] != '\0')
+		{
+			info.valid = false;
+			std::snprintf(info.error, sizeof(info.error), "Not a .scl file.\nSCL tuning reset to standard.");
+		}
+		//d_stdout("ScaleSequence-Plus: tuning scl reset");
+	}
+}
+
+void ScaleSequencePlusCore::readKbm(Tunings::Tuning & tn, const char* value, TuningFileInfo& info)
+{
+	auto s = tn.scale;
+
+	if (endsWith(value, ".kbm"))
+	{
+		try
+		{
+			auto k = Tunings::readKBMFile(value);
+			tn = Tunings::Tuning(s, k);
+			describeKbm(info, tn.keyboardMapping, value);
+			//d_stdout("ScaleSequence-Plus: tuning set to %s", value);
+		}
+		catch (const std::exception& e)
+		{
+			tn = Tunings::Tuning();
+			describeKbm(info, tn.keyboardMapping, nullptr);
+			rejectFile(info, e);
+		}
+	}
+	else
+	{
+		auto k = Tunings::Tuning().keyboardMapping;
+		tn = Tunings::Tuning(s, k);
+		describeKbm(info, tn.keyboardMapping, nullptr);
+
+		if (value[0] != '\0')
+		{
+			info.valid = false;
+			std::snprintf(info.error, sizeof(info.error), "Not a .kbm file.\nKBM mapping reset to standard.");
+		}
+		//d_stdout("ScaleSequence-Plus: tuning kbm reset");
+	}
+}
+
+/**
+   Fill in the UI info for a scale. @a path is the file it was loaded from, or null for the standard tuning.
+ */
+void ScaleSequencePlusCore::describeScl(TuningFileInfo& info, const Tunings::Scale& scale, const char* path)
+{
+	std::memset(&info, 0, sizeof(info));
+	info.valid = true;
+	info.noteCount = scale.count;
+	info.period = scale.tones.empty() ? 0.0 : scale.tones.back().cents;
+
+	if (path != nullptr)
+		copyFileBaseName(info.name, sizeof(info.name), path);
+	else
+		std::snprintf(info.name, sizeof(info.name), "Standard SCL tuning");
+}
+
+void ScaleSequencePlusCore::describeKbm(TuningFileInfo& info, const Tunings::KeyboardMapping& mapping, const char* path)
+{
+	std::memset(&info, 0, sizeof(info));
+	info.valid = true;
+	info.noteCount = mapping.count;
+	info.period = mapping.octaveDegrees;
+
+	if (path != nullptr)
+		copyFileBaseName(info.name, sizeof(info.name), path);
+	else
+		std::snprintf(info.name, sizeof(info.name), "Standard KBM mapping");
+}
+
+/**
+   A file failed to parse. The whole tuning of the slot has been reset, the other file of the pair included.
+ */
+void ScaleSequencePlusCore::rejectFile(TuningFileInfo& info, const std::exception& e)
+{
+	info.valid = false;
+	info.pairReset = true;
+	std::snprintf(info.error, sizeof(info.error), "Tuning error:\n%s\nScale reset to standard tuning and mapping.", e.what());
+}
+
+void ScaleSequencePlusCore::copyFileBaseName(char* dst, std::size_t size, const char* path)
+{
+	const char* base = path;
+	for (const char* c = path; *c != '\0'; ++c)
+	{
+		if (*c == '/' || *c == '\\')
+			base = c + 1;
+	}
+	std::snprintf(dst, size, "%s", base);
+}
+
+bool ScaleSequencePlusCore::endsWith(const char* text, const char* suffix)
+{
+	const std::size_t length = std::strlen(text);
+	const std::size_t suffixLength = std::strlen(suffix);
+	return length >= suffixLength && std::strcmp(text + length - suffixLength, suffix) == 0;
+}
+
+/* -----------------------------------------------------------------------------------------------------------
+ * MTS-ESP master thread */
+
+/**
+   One thread for the whole process that registers and deregisters the MTS-ESP master for every activated core, so
+   run() never calls into libMTS for it. Each core is checked about ten times a second, and all of them again straight
+   away when one lets the master go, so another instance takes over within a block or two. The thread only runs while
+   some core is activated, and is left alone at exit, so unloading the plugin never waits on it.
+ */
+class ScaleSequencePlusMasterThread
+{
+public:
+    static ScaleSequencePlusMasterThread& get()
+    {
+        static ScaleSequencePlusMasterThread* const instance = new ScaleSequencePlusMasterThread();
+        return *instance;
+    }
+
+    void add(ScaleSequencePlusCore* core)
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+
+        if (std::find(fCores.begin(), fCores.end(), core) != fCores.end())
+            return;
+
+        // The first try is made here, so a core that can be the master is one from its first block
+        core->updateMaster();
+        fCores.push_back(core);
+
+        if (!fThread.joinable())
+            fThread = std::thread(&ScaleSequencePlusMasterThread::poll, this, fGeneration);
+    }
+
+    /**
+       Once this returns, @a core is not touched by the thread any more.
+     */
+    void remove(ScaleSequencePlusCore* core)
+    {
+        std::thread stopped;
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fCores.erase(std::remove(fCores.begin(), fCores.end(), core), fCores.end());
+
+            if (fCores.empty() && fThread.joinable())
+            {
+                fGeneration++;
+                stopped.swap(fThread);
+            }
+        }
+
+        if (stopped.joinable())
+        {
+            fCondition.notify_all();
+            stopped.join();
+        }
+    }
+
+    /**
+       Check every core now, the master has been let go.
+     */
+    void wake()
+    {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fWake = true;
+        }
+        fCondition.notify_all();
+    }
+
+private:
+    ScaleSequencePlusMasterThread()
+        : fGeneration(0),
+          fWake(false) {}
+
+    // A thread stops when fGeneration moves on, even if a new one has been started by then
+    void poll(uint32_t generation)
+    {
+        std::unique_lock<std::mutex> lock(fMutex);
+
+        while (generation == fGeneration)
+        {
+            fWake = false;
+
+            bool released = false;
+            for (ScaleSequencePlusCore* core : fCores)
+                released = core->updateMaster() || released;
+            if (released)
+                continue;
+
+            fCondition.wait_for(lock, std::chrono::milliseconds(100),
+                                [&] { return fWake || generation != fGeneration; });
+        }
+    }
+
+    std::mutex fMutex;
+    std::condition_variable fCondition;
+    std::vector<ScaleSequencePlusCore*> fCores;
+    std::thread fThread;
+    uint32_t fGeneration;
+    bool fWake;
+};
+
+/* -----------------------------------------------------------------------------------------------------------
+ * Activate / Deactivate */
+
+void ScaleSequencePlusCore::activate(double sampleRate)
+{
+	sample_rate = sampleRate;
+
+	trace_frame = 0;
+	trace_gliding = false;
+	fTrace.add(kTraceActivate, 0, static_cast<int32_t>(sampleRate));
+	fTrace.add(kTraceStep, 0, fHot.lane_steps[0]);
+
+	// The sequence stays on its step, but the first block is not taken as a jump from before
+	fHot.transport.reset();
+	fHot.tempo.reset();
+
+	// The first scale is taken without a glide from whatever the table was before
+	fHot.current_scale = 0;
+	fHot.snap_to_target = true;
+
+	ScaleSequencePlusMasterThread::get().add(this);
+}
+
+void ScaleSequencePlusCore::deactivate()
+{
+    ScaleSequencePlusMasterThread::get().remove(this);
+
+    // run() is not called any more, so everything can be handed back from here
+    const uint32_t state = fMasterState.load(std::memory_order_acquire);
+    if (state == kMasterActive)
+        handBackMaster();
+    if (state != kMasterNone)
+    {
+        sink().deregisterMaster();
+        fMasterState.store(kMasterNone, std::memory_order_release);
+        ScaleSequencePlusMasterThread::get().wake();
+    }
+
+    fHot.is_master = false;
+    fHot.parameters[kParameterMasterStatus] = 0.0f;
+}
+
+/**
+   The master thread's side of the MTS-ESP master, never called from run(): libMTS may lock and look for masters in
+   other processes. Registers while activated, not bypassed, and no other instance or process holds the master,
+   and deregisters once run() has handed everything back. Returns true if the master was let go.
+ */
+bool ScaleSequencePlusCore::updateMaster()
+{
+	switch (fMasterState.load(std::memory_order_acquire))
+	{
+	case kMasterNone:
+		if (!fBypassed.load(std::memory_order_relaxed) && sink().registerMaster(this))
+			fMasterState.store(kMasterRegistered, std::memory_order_release);
+		return false;
+	case kMasterReleased:
+		sink().deregisterMaster();
+		fMasterState.store(kMasterNone, std::memory_order_release);
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+   Called at the start of every block. Takes over once the master thread has registered, and hands back when bypassed;
+   is_master tells the rest of the block whether to publish to MTS-ESP.
+ */
+void ScaleSequencePlusCore::updateMasterStatus()
+{
+	const bool bypassed = fHot.parameters[kParameterBypass] >= 0.5f;
+
+	switch (fMasterState.load(std::memory_order_acquire))
+	{
+	case kMasterRegistered:
+		if (!bypassed)
+		{
+			takeOverMaster();
+			fMasterState.store(kMasterActive, std::memory_order_release);
+			fHot.is_master = true;
+		}
+		else
+			fMasterState.store(kMasterReleased, std::memory_order_release);
+		break;
+	case kMasterActive:
+		if (bypassed)
+		{
+			handBackMaster();
+			fMasterState.store(kMasterReleased, std::memory_order_release);
+			fHot.is_master = false;
+		}
+		break;
+	default:
+		break;
+	}
+
+	fHot.parameters[kParameterMasterStatus] = fHot.is_master ? 1.0f : 0.0f;
+}
+
+/**
+   Just became the master.
+ */
+void ScaleSequencePlusCore::takeOverMaster()
+{
+	// The scale kept following the sequence, but the table only glided along with the SysEx or MPE output, and MTS-ESP
+	// has none of it yet. The table snaps to the scale and goes out with the next block, the channel tables and the
+	// note filter are published from scratch.
+	fHot.snap_to_target = true;
+	if (fHot.current_scale != 0)
+		sink().setScaleName(scale_info[fHot.current_scale]->name);
+	fHot.glide_converged = false;
+	channels_enabled = 0;
+	for (int32_t ch = 0; ch < kNumChannels; ch++)
+		channel_scale[ch] = -1;
+
+	sink().clearNoteFilter();
+	std::memset(note_filter, 0, sizeof(note_filter));
+	note_filter_shared = true;
+	note_filter_dirty = true;
+}
+
+/**
+   Stop publishing, before the master thread deregisters.
+ */
+void ScaleSequencePlusCore::handBackMaster()
+{
+	// Hand the channels back to the global table before letting go
+	for (int32_t ch = 0; ch < kNumChannels; ch++)
+	{
+		if (channels_enabled & (1u << ch))
+			sink().setMultiChannel(false, static_cast<char>(ch));
+	}
+	channels_enabled = 0;
+
+	sink().clearNoteFilter();
+}
+
+/* -----------------------------------------------------------------------------------------------------------
+ * Audio/MIDI Processing */
+
+void ScaleSequencePlusCore::run(uint32_t frames, const ScaleSequencePlusTransport& transport,
+                                const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount)
+{
+	const uint64_t perfStart = fPerfStats.begin();
+	block_publishes = 0;
+
+	takeScaleInfo();
+
+	const TransportChanges change = fHot.transport.update(transport.playing, transport.frame, frames);
+	if (change != kTransportSteady)
+		transportChanged(change);
+
+	// The tempo is only taken to run on from the last block while the transport plays on without a jump
+	if (transport.bbt.valid)
+		fHot.tempo.update(transport.bbt.beatsPerMinute, frames, change == kTransportSteady && transport.playing);
+	else
+		fHot.tempo.reset();
+
+	updateMasterStatus();
+
+	// The step type only changes with its parameter, so each one gets a copy of the block processing
+	// without any step type checks in it
+	if (fHot.parameters[kParameterBypass] >= 0.5f)
+		runBypassed(midiEvents, midiEventCount);
+	else switch (fHot.step_mode)
+	{
+	case kStepBars:
+		runBlock<kStepBars>(frames, transport, midiEvents, midiEventCount);
+		break;
+	case kStepMidiNote:
+		runBlock<kStepMidiNote>(frames, transport, midiEvents, midiEventCount);
+		break;
+	default:
+		runBlock<kStepBeats>(frames, transport, midiEvents, midiEventCount);
+		break;
+	}
+
+	if (block_publishes != 0)
+		fTrace.add(kTracePublish, trace_frame, static_cast<int32_t>(block_publishes));
+	trace_frame += frames;
+
+	fPerfStats.end(perfStart, frames);
+}
+
+/**
+   The host transport started, stopped or jumped. MIDI Note stepping goes back to before the start of the sequence if
+   the Step Reset parameter asks for it; beats and bars are taken from the host position in every block anyway.
+ */
+void ScaleSequencePlusCore::transportChanged(TransportChanges change)
+{
+	switch (change)
+	{
+	case kTransportStarted:
+		fTrace.add(kTraceTransportStart, trace_frame);
+		break;
+	case kTransportStopped:
+		fTrace.add(kTraceTransportStop, trace_frame);
+		break;
+	default:
+		fTrace.add(kTraceTransportJump, trace_frame,
+		           static_cast<int32_t>(limit<int64_t>(fHot.transport.getJump(), INT32_MIN, INT32_MAX)));
+		break;
+	}
+
+	const int32_t policy = static_cast<int32_t>(fHot.parameters[kParameterStepReset]);
+	if (policy == kStepResetOnJump || (policy == kStepResetOnStop && change == kTransportStopped))
+	{
+		for (int32_t lane = 0; lane < kNumLanes; lane++)
+			fHot.lane_steps[lane] = -1;
+	}
+}
+
+void ScaleSequencePlusCore::countPublishes(uint32_t count)
+{
+	block_publishes += count;
+	fPerfStats.countPublishes(count);
+}
+
+template <StepModes kMode>
+void ScaleSequencePlusCore::runBlock(uint32_t frames, const ScaleSequencePlusTransport& transport, const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount)
+{
+    const int32_t laneCount = activeLanes();
+    int32_t loopPoints[kNumLanes];
+    int32_t steps[kNumLanes];
+    for (int32_t lane = 0; lane < laneCount; lane++)
+    {
+        loopPoints[lane] = static_cast<int32_t>(fHot.parameters[laneParameter(lane, kLaneLoopPoint)]);
+        steps[lane] = fHot.lane_steps[lane];
+    }
+
+    // Lane steps starting later in the block, with the frame they start at
+    LaneStepChange changes[kMaxStepChanges];
+    uint32_t changeCount = 0;
+
+    if constexpr (kMode == kStepMidiNote)
+    {
+        // Every note on advances the step of every lane. All MIDI events are passed through to MIDI out at the end
+        // of the block, after any tuning SysEx for this block.
+        for (uint32_t currentMidiEvent = 0; currentMidiEvent < midiEventCount; ++currentMidiEvent)
+        {
+            if (midiEvents[currentMidiEvent].size <= 3 && (midiEvents[currentMidiEvent].data[0] & 0xF0) == 0x90)
+            {
+                for (int32_t lane = 0; lane < laneCount; lane++)
+                    steps[lane] = nextNoteStep(steps[lane], loopPoints[lane]);
+                fTrace.add(kTraceMidiTrigger, trace_frame + midiEvents[currentMidiEvent].frame, midiEvents[currentMidiEvent].data[1]);
+            }
+        }
+    }
+    else if (transport.bbt.valid) // Using beats or bars to find step position, if the host says where it is
+    {
+        const ScaleSequencePlusTransport& timePos(transport);
+
+        // In DISTRHO DPF, the first bar and the first beat of the bar are 1. Our calculations require them to be 0.
+        const int64_t ticksPerBar = std::llround(timePos.bbt.beatsPerBar * kLaneTicksPerBeat);
+        const double ticksIntoBar = (timePos.bbt.beat - 1 + timePos.bbt.tick / timePos.bbt.ticksPerBeat) * kLaneTicksPerBeat;
+        const int64_t position = (timePos.bbt.bar - 1) * ticksPerBar + static_cast<int64_t>(std::floor(ticksIntoBar));
+
+        LaneGrid grids[kNumLanes];
+        for (int32_t lane = 0; lane < laneCount; lane++)
+            grids[lane] = laneGridFor(kMode, fHot.parameters[laneParameter(lane, kLaneMultiplier)], fHot.parameters[kParameterOffset], ticksPerBar);
+
+        // Where the following steps start, following the tempo ramp if there is one. Any beyond kMaxStepChanges
+        // are picked up at the start of the next block.
+        changeCount = scheduleLanes(grids, loopPoints, laneCount, position, ticksIntoBar - std::floor(ticksIntoBar), fHot.tempo, sample_rate, frames,
+                                    steps, changes, timePos.playing ? kMaxStepChanges : 0);
+    }
+
+    for (int32_t lane = 0; lane < laneCount; lane++)
+    {
+        if (steps[lane] != fHot.lane_steps[lane])
+            startLaneStep(lane, steps[lane], 0);
+    }
+
+    // The steps and the scale follow the sequence whether or not this instance is the MTS-ESP master. The table only
+    // glides for the master and for the SysEx and MPE output; other instances skip all glide and publish work, and
+    // snap to the scale the sequence is on if they take over.
+    const bool retuning = fHot.is_master || static_cast<int32_t>(fHot.parameters[kParameterSysExMode]) != kSysExOff
+                          || fHot.parameters[kParameterMpeOutput] > 0.5f;
+    switch_frame = 0;
+    switchScale(combinedScale(), 0);
+
+	// Just activated
+	if (fHot.snap_to_target)
+	{
+		std::memcpy(fHot.frequencies, fHot.targets, sizeof(fHot.frequencies));
+		std::memcpy(glide_origin_in_hz, fHot.targets, sizeof(glide_origin_in_hz));
+		fHot.snap_to_target = false;
+#if SCALESEQUENCE_PLUS_FLOAT_GLIDE
+		fHot.glide_in_float = false; // the offsets are stale, the double glide arrives at once
+#endif
+		fHot.glide_converged = false; // publish the new table at least once
+	}
+
+	// Glide up to each frame where lane steps start, then switch to the scale the lanes make up from there
+	bool gliding = false;
+	uint32_t done = 0;
+	for (uint32_t i = 0; i < changeCount; i++)
+	{
+		if (const uint32_t segment = changes[i].frame - done; segment != 0 && retuning)
+			gliding |= fHot.glide_converged ? runGlide<true>(segment) : runGlide<false>(segment);
+		done = changes[i].frame;
+
+		startLaneStep(changes[i].lane, changes[i].step, done);
+		if (i + 1 == changeCount || changes[i + 1].frame != done)
+			switchScale(combinedScale(), done);
+	}
+	if (retuning)
+		gliding |= fHot.glide_converged ? runGlide<true>(frames - done) : runGlide<false>(frames - done);
+
+	if (gliding)
+	{
+		sysex_dirty = true;
+		fPerfStats.setGliding();
+	}
+
+	if (gliding != trace_gliding)
+	{
+		fTrace.add(gliding ? kTraceGlideStart : kTraceGlideEnd, trace_frame);
+		trace_gliding = gliding;
+	}
+
+	if (fTuningSnapshots.wantsWrite())
+		writeTuningSnapshot();
+
+	// The channel tables and the note filter are for MTS-ESP only
+	if (fHot.is_master)
+	{
+		runChannels(frames);
+
+		if (note_filter_dirty)
+			publishNoteFilter();
+	}
+
+	// The MIDI goes out in frame order, with the tuning for a scale switch on the frame of the switch: first the MIDI
+	// that came in before it, then the SysEx and the bends for the notes already playing, then the rest
+	updateSysExBudget(frames);
+	const bool mpe = updateMpeStatus();
+	uint32_t before = 0;
+	while (before < midiEventCount && midiEvents[before].frame < switch_frame)
+		++before;
+
+	passMidiThrough(mpe, gliding, midiEvents, before);
+	runSysEx(gliding);
+	if (mpe)
+		updateMpeBends(gliding);
+	passMidiThrough(mpe, gliding, midiEvents + before, midiEventCount - before);
+}
+
+/**
+   Lane @a lane moves on to step @a step, @a frame frames into the block. Also the lane's current step output, which
+   counts steps from 1 in 1/32 units.
+ */
+void ScaleSequencePlusCore::startLaneStep(int32_t lane, int32_t step, uint32_t frame)
+{
+    fHot.lane_steps[lane] = step;
+    fHot.lane_started[lane] = ++fHot.lane_clock;
+    fHot.parameters[laneParameter(lane, kLaneCurrentStep)] = static_cast<float>((step + 1) * 0.03125f);
+
+    if (lane == 0)
+        fTrace.add(kTraceStep, trace_frame + frame, step);
+    else
+        fTrace.add(kTraceLaneStep, trace_frame + frame, (lane + 1) * 256 + step + 1);
+}
+
+/**
+   The scale on the step lane @a lane is on, 0 for none: before the start of the sequence, or a step that is off.
+ */
+int32_t ScaleSequencePlusCore::laneScale(int32_t lane) const
+{
+    const int32_t step = fHot.lane_steps[lane];
+    return step >= 0 && step < kNumSteps ? static_cast<int32_t>(fHot.parameters[laneParameter(lane, kLaneStep1 + step)]) : 0;
+}
+
+/**
+   The scale the active lanes make up, following the Lane Combine parameter, 0 if none of them has one.
+   With kCombinePriority the highest lane with a scale wins, with kCombineLastChanged the lane whose step started
+   last; of lanes whose steps started together, the highest.
+ */
+int32_t ScaleSequencePlusCore::combinedScale() const
+{
+    const bool lastChanged = static_cast<int32_t>(fHot.parameters[kParameterLaneCombine]) == kCombineLastChanged;
+    const int32_t laneCount = activeLanes();
+
+    int32_t scale = 0;
+    uint32_t started = 0;
+    for (int32_t lane = 0; lane < laneCount; lane++)
+    {
+        const int32_t laneScaleNow = laneScale(lane);
+        if (laneScaleNow == 0 || (lastChanged && fHot.lane_started[lane] < started))
+            continue;
+
+        scale = laneScaleNow;
+        started = fHot.lane_started[lane];
+    }
+    return scale;
+}
+
+int32_t ScaleSequencePlusCore::activeLanes() const
+{
+    return limit<int32_t>(static_cast<int32_t>(fHot.parameters[kParameterLanes]), 1, kNumLanes);
+}
+
+/**
+   Switch to scale @a scale, @a frame frames into the block, unless it is already the current one.
+   Scale 0 is no scale, and the tuning stays as it is.
+ */
+void ScaleSequencePlusCore::switchScale(int32_t scale, uint32_t frame)
+{
+    if (scale == fHot.current_scale)
+        return;
+
+    if (scale >= 1 && scale <= 8)
+    {
+        std::memcpy(fHot.targets, scale_info[scale]->frequencies, sizeof(fHot.targets));
+
+        std::memcpy(glide_origin_in_hz, fHot.frequencies, sizeof(glide_origin_in_hz));
+#if SCALESEQUENCE_PLUS_FLOAT_GLIDE
+        startFloatGlide();
+#endif
+        fHot.glide_converged = false;
+        fHot.current_scale = scale;
+        switch_frame = frame;
+        fTrace.add(kTraceScaleSwitch, trace_frame + frame, scale);
+        if (fHot.is_master)
+            sink().setScaleName(scale_info[scale]->name);
+        note_filter_dirty = true;
+        sysex_dirty = true;
+        sysex_bulk_pending = true;
+    }
+}
+
+/**
+   Scale glide, continuous tuning, done via division of the remaining difference to target for every frame,
+   and publishing the table after each frame. Returns true if the table moved.
+   Once the table has arrived it stays put until the next scale switch, so the converged specialization
+   only publishes it once per block, and the gliding one stops at the frame it arrives.
+ */
+template <bool kConverged>
+bool ScaleSequencePlusCore::runGlide(uint32_t frames)
+{
+	if constexpr (kConverged)
+	{
+		if (fHot.is_master)
+		{
+			sink().setNoteTunings(fHot.frequencies);
+			countPublishes(1);
+		}
+		return false;
+	}
+	else
+	{
+		if (fHot.offline_glide)
+		{
+			fHot.glide_converged = glideTable(fHot.frequencies, fHot.targets,
+			                                  glideRemaining(fHot.parameters[kParameterScaleGlide], frames));
+			if (fHot.is_master)
+			{
+				sink().setNoteTunings(fHot.frequencies);
+				countPublishes(1);
+			}
+			return true;
+		}
+
+#if SCALESEQUENCE_PLUS_FLOAT_GLIDE
+		if (fHot.glide_in_float)
+			return runFloatGlide(frames);
+#endif
+
+		const double divisor = fHot.parameters[kParameterScaleGlide] * 1000.0;
+		bool gliding = false;
+		uint32_t fr = 0;
+
+		while (fr < frames)
+		{
+			bool moved = false;
+			for (int32_t i = 0; i < 128; i++)
+			{
+				double difference = fHot.targets[i] - fHot.frequencies[i];
+				if (std::fabs(difference) < 0.0001f)
+					fHot.frequencies[i] = fHot.targets[i];
+				else
+				{
+					fHot.frequencies[i] = fHot.frequencies[i] + (difference / divisor);
+					moved = true;
+				}
+			}
+			// Set MTS-ESP Scale
+			if (fHot.is_master)
+				sink().setNoteTunings(fHot.frequencies);
+			++fr;
+
+			if (!moved)
+			{
+				fHot.glide_converged = true;
+				break;
+			}
+			gliding = true;
+		}
+		if (fHot.is_master)
+			countPublishes(fr);
+
+		return gliding;
+	}
+}
+
+#if SCALESEQUENCE_PLUS_FLOAT_GLIDE
+/**
+   The glide in single precision. Every frame takes the same fraction of the remaining difference, so after n frames
+   the table is the targets plus the offsets from the start of the glide times (1 - 1/divisor)^n. Only that factor is
+   carried from frame to frame, in double precision; the offsets are rounded to float once, here.
+   A note is then off by at most three float roundings of its offset. Against the lowest frequency it passes through,
+   that is below 0.01 cents while the offset is within kFloatGlideRange times that frequency, which is five octaves.
+   Wider glides only come from scales mapped far outside the audible range, and are left to the double glide.
+ */
+void ScaleSequencePlusCore::startFloatGlide()
+{
+	fHot.glide_in_float = true;
+	fHot.glide_position = 1.0;
+
+	for (int32_t i = 0; i < 128; i++)
+	{
+		const double offset = fHot.frequencies[i] - fHot.targets[i];
+		fHot.glide_offsets[i] = static_cast<float>(offset);
+
+		if (std::fabs(offset) > kFloatGlideRange * std::min(fHot.frequencies[i], fHot.targets[i]))
+			fHot.glide_in_float = false;
+	}
+}
+
+bool ScaleSequencePlusCore::runFloatGlide(uint32_t frames)
+{
+	const double decay = 1.0 - 1.0 / (fHot.parameters[kParameterScaleGlide] * 1000.0);
+	bool gliding = false;
+	uint32_t fr = 0;
+
+	// Distances are compared as integers: for positive floats the order is the same, and unlike a float
+	// comparison it cannot trap, so the compiler is free to vectorize the loop
+	const float snapDistance = 0.0001f;
+	int32_t snapBits;
+	std::memcpy(&snapBits, &snapDistance, sizeof(snapBits));
+
+	while (fr < frames)
+	{
+		// Notes that were within 0.0001 Hz of the target before this frame snap to it, as in the double glide
+		const float before = static_cast<float>(fHot.glide_position);
+		fHot.glide_position *= decay;
+		const float after = static_cast<float>(fHot.glide_position);
+
+		int32_t moving = 0;
+		for (int32_t i = 0; i < 128; i++)
+		{
+			const float offset = fHot.glide_offsets[i];
+			const float distance = std::fabs(offset) * before;
+			int32_t distanceBits;
+			std::memcpy(&distanceBits, &distance, sizeof(distanceBits));
+			const int32_t moved = distanceBits >= snapBits ? 1 : 0;
+
+			fHot.frequencies[i] = fHot.targets[i] + static_cast<double>(offset * after * static_cast<float>(moved));
+			moving += moved;
+		}
+		// Set MTS-ESP Scale
+		if (fHot.is_master)
+			sink().setNoteTunings(fHot.frequencies);
+		++fr;
+
+		if (moving == 0)
+		{
+			fHot.glide_converged = true;
+			break;
+		}
+		gliding = true;
+	}
+	if (fHot.is_master)
+		countPublishes(fr);
+
+	return gliding;
+}
+#endif
+
+/**
+   Copy the tuning tables for the tuning view in the UI. Only called when the UI asked for a new frame.
+ */
+void ScaleSequencePlusCore::writeTuningSnapshot()
+{
+	TuningSnapshot& snapshot(fTuningSnapshots.beginWrite());
+
+	snapshot.scale = fHot.current_scale;
+	for (int32_t i = 0; i < 128; i++)
+	{
+		snapshot.current[i] = static_cast<float>(fHot.frequencies[i]);
+		snapshot.target[i] = static_cast<float>(fHot.targets[i]);
+		snapshot.origin[i] = static_cast<float>(glide_origin_in_hz[i]);
+	}
+
+	fTuningSnapshots.endWrite();
+}
+
+/**
+   Pass the MIDI through, retuned for MPE if @a mpe, which is what updateMpeStatus() returned for the block.
+ */
+void ScaleSequencePlusCore::passMidiThrough(bool mpe, bool gliding, const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount)
+{
+	if (mpe)
+	{
+		runMpe(gliding, midiEvents, midiEventCount);
+		return;
+	}
+
+	for (uint32_t currentMidiEvent = 0; currentMidiEvent < midiEventCount; ++currentMidiEvent)
+		sendMidi(midiEvents[currentMidiEvent]);
+}
+
+/**
+   A bypassed block: the sequence stands still and the MIDI goes out as it came in. Notes still playing on MPE member
+   channels are stopped first, as the note offs for them will come in on their own channels.
+ */
+void ScaleSequencePlusCore::runBypassed(const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount)
+{
+	if (mpe_active)
+	{
+		releaseMpeVoices();
+		writeMpeConfiguration(0);
+		mpe_active = false;
+	}
+
+	for (uint32_t currentMidiEvent = 0; currentMidiEvent < midiEventCount; ++currentMidiEvent)
+		sendMidi(midiEvents[currentMidiEvent]);
+}
+
+/**
+   The bytes the MIDI link can take in this block, for the SysEx output. Called before anything is written in the
+   block; every message written after it, with sendMidi(), is taken from the budget: the MIDI passed through, the MPE
+   output and its configuration, and the SysEx itself. What is written after the SysEx is taken from the budget of
+   the next block.
+ */
+void ScaleSequencePlusCore::updateSysExBudget(uint32_t frames)
+{
+	const int32_t mode = static_cast<int32_t>(fHot.parameters[kParameterSysExMode]);
+
+	if (mode != sysex_mode)
+	{
+		// Everything has to be sent again in the new mode
+		sysex_mode = mode;
+		std::memset(sysex_sent, 0xFF, sizeof(sysex_sent));
+		sysex_dirty = true;
+		sysex_bulk_pending = true;
+	}
+
+	if (mode == kSysExOff)
+	{
+		sysex_budget = 0.0;
+		return;
+	}
+
+	if (fHot.parameters[kParameterSysExDinRate] > 0.5f)
+	{
+		sysex_budget += frames * kMidiDinBytesPerSecond / sample_rate;
+
+		// Don't save up more than one bulk dump worth
+		if (sysex_budget > kMtsBulkDumpSize)
+			sysex_budget = kMtsBulkDumpSize;
+	}
+	else
+	{
+		// No link limit, just one full message per block
+		sysex_budget = kMtsNoteChangeMaxSize;
+	}
+}
+
+/**
+   MIDI Tuning Standard SysEx output, for synths that can't talk to MTS-ESP.
+   Single Note mode sends one real-time note change message per block at most, containing only the notes whose
+   tuning changed since they were last sent. Bulk Dump mode sends the preformatted dump for a scale when it
+   becomes active. Either way the bytes sent are limited to what the MIDI link can carry, including all the other
+   MIDI the core writes, see updateSysExBudget(), and whatever doesn't fit is sent in a later block.
+ */
+void ScaleSequencePlusCore::runSysEx(bool gliding)
+{
+	const int32_t mode = sysex_mode;
+	if (mode == kSysExOff)
+		return;
+
+	if (fHot.current_scale < 1 || fHot.current_scale > 8)
+		return;
+
+	if (mode == kSysExBulkDump)
+	{
+		if (!sysex_bulk_pending || sysex_budget < kMtsBulkDumpSize)
+			return;
+
+		writeSysEx(scale_info[fHot.current_scale]->bulk_dump, kMtsBulkDumpSize);
+		sysex_bulk_pending = false;
+		return;
+	}
+
+	if (!sysex_dirty)
+		return;
+
+	// How many notes fit in the budget?
+	const double budget_notes = (sysex_budget - kMtsNoteChangeHeaderSize - 1) / 4.0;
+	if (budget_notes < 1.0)
+		return;
+	const uint32_t max_notes = budget_notes < kMtsNoteChangeMaxNotes ? static_cast<uint32_t>(budget_notes) : kMtsNoteChangeMaxNotes;
+
+	// Once the glide has settled the precomputed words for the scale can be used as is
+	const uint8_t (*words)[3] = scale_info[fHot.current_scale]->mts_words;
+	if (gliding)
+	{
+		for (int32_t i = 0; i < 128; i++)
+			encodeMtsFrequency(fHot.frequencies[i], sysex_words[i]);
+		words = sysex_words;
+	}
+
+	// Collect the notes that changed, starting where the last message left off so every note gets its turn
+	uint32_t pos = beginMtsNoteChange(sysex_buffer);
+	uint32_t count = 0;
+	bool complete = true;
+
+	for (uint32_t n = 0; n < 128; n++)
+	{
+		const uint32_t note = (sysex_cursor + n) & 127;
+
+		if (std::memcmp(sysex_sent[note], words[note], 3) == 0)
+			continue;
+
+		if (count == max_notes)
+		{
+			sysex_cursor = note;
+			complete = false;
+			break;
+		}
+
+		pos = appendMtsNoteChange(sysex_buffer, pos, static_cast<uint8_t>(note), words[note]);
+		std::memcpy(sysex_sent[note], words[note], 3);
+		count++;
+	}
+
+	if (count != 0)
+	{
+		pos = finishMtsNoteChange(sysex_buffer, pos);
+		writeSysEx(sysex_buffer, pos);
+	}
+
+	sysex_dirty = gliding || !complete;
+}
+
+/**
+   Turn MPE output on or off, following the parameters. Returns true while MPE output is on.
+   The MPE configuration (a lower zone using all 15 member channels) and the member channel pitch bend range
+   are sent whenever the output is turned on or the bend range changes.
+ */
+bool ScaleSequencePlusCore::updateMpeStatus()
+{
+	const bool wanted = fHot.parameters[kParameterMpeOutput] > 0.5f;
+	const int32_t range = static_cast<int32_t>(fHot.parameters[kParameterMpeBendRange]);
+
+	if (wanted == mpe_active && (!wanted || range == mpe_bend_range))
+		return mpe_active;
+
+	if (!wanted)
+	{
+		releaseMpeVoices();
+		writeMpeConfiguration(0);
+		mpe_active = false;
+		return false;
+	}
+
+	if (!mpe_active)
+		resetMpeVoices();
+
+	mpe_active = true;
+	mpe_bend_range = range;
+	writeMpeConfiguration(kMpeMemberChannels);
+
+	// Bends have to be recalculated for the new range
+	for (uint8_t ch = 1; ch <= kMpeMemberChannels; ch++)
+		mpe_voices[ch].bend = -1;
+
+	return true;
+}
+
+/**
+   MPE / pitch bend retuning output, for synths that support neither MTS-ESP nor MTS SysEx.
+   Each note-on gets a member channel of its own, with a pitch bend taken from the active tuning, so that an
+   equal-tempered synth plays it at the tuned frequency. Other channel messages go to the master channel.
+ */
+void ScaleSequencePlusCore::runMpe(bool gliding, const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount)
+{
+	for (uint32_t currentMidiEvent = 0; currentMidiEvent < midiEventCount; ++currentMidiEvent)
+	{
+		const ScaleSequencePlusMidiEvent& event(midiEvents[currentMidiEvent]);
+
+		if (event.size > 3 || event.size == 0 || event.data[0] >= 0xF0)
+		{
+			sendMidi(event);
+			continue;
+		}
+
+		const uint8_t status = event.data[0] & 0xF0;
+		const uint8_t channel = event.data[0] & 0x0F;
+		const uint8_t note = event.data[1] & 0x7F;
+
+		if (status == 0x90 && event.data[2] != 0)
+		{
+			// A retriggered note keeps the channel it had
+			if (mpe_note_channel[channel][note] >= 0)
+				stopMpeVoice(static_cast<uint8_t>(mpe_note_channel[channel][note]), event.frame);
+
+			const uint8_t member = allocateMpeVoice(event.frame);
+			mpe_voices[member].in_channel = static_cast<int8_t>(channel);
+			mpe_voices[member].note = static_cast<int8_t>(note);
+			mpe_voices[member].bend = -1;
+			mpe_note_channel[channel][note] = static_cast<int8_t>(member);
+
+			updateMpeBend(member, event.frame, gliding);
+			writeMpeMessage(event.frame, 0x90 | member, note, event.data[2]);
+		}
+		else if (status == 0x80 || status == 0x90)
+		{
+			// A note off for a note that is not playing here, started before the output was on or stolen, goes out
+			// as it came in, for whatever is still playing it
+			const int8_t member = mpe_note_channel[channel][note];
+			if (member >= 0)
+			{
+				writeMpeMessage(event.frame, 0x80 | member, note, status == 0x80 ? event.data[2] : 0x40);
+				freeMpeVoice(static_cast<uint8_t>(member));
+			}
+			else
+				sendMidi(event);
+		}
+		else if (status == 0xA0)
+		{
+			// Polyphonic pressure becomes channel pressure on the note's own channel
+			const int8_t member = mpe_note_channel[channel][note];
+			if (member >= 0)
+				writeMpeMessage(event.frame, 0xD0 | member, event.data[2], 0, 2);
+		}
+		else
+		{
+			// Everything else applies to the whole zone
+			ScaleSequencePlusMidiEvent zoneEvent(event);
+			zoneEvent.data[0] = status;
+			sendMidi(zoneEvent);
+		}
+	}
+}
+
+/**
+   Follow the glide, or a scale switch, on the notes that are already playing. The bends go out on the frame the scale
+   switched on in this block, if it did.
+ */
+void ScaleSequencePlusCore::updateMpeBends(bool gliding)
+{
+	for (uint8_t ch = 1; ch <= kMpeMemberChannels; ch++)
+	{
+		if (mpe_voices[ch].note >= 0)
+			updateMpeBend(ch, switch_frame, gliding);
+	}
+}
+
+uint8_t ScaleSequencePlusCore::allocateMpeVoice(uint32_t frame)
+{
+	if (mpe_free_count != 0)
+	{
+		const uint8_t member = mpe_free[mpe_free_head];
+		mpe_free_head = (mpe_free_head + 1) % kMpeMemberChannels;
+		mpe_free_count--;
+		return member;
+	}
+
+	// Every channel is busy: steal, round-robin
+	const uint8_t member = static_cast<uint8_t>(mpe_steal_cursor + 1);
+	mpe_steal_cursor = (mpe_steal_cursor + 1) % kMpeMemberChannels;
+	stopMpeVoice(member, frame);
+
+	// stopMpeVoice() put the channel back in the pool, take it out again
+	mpe_free_count--;
+	return member;
+}
+
+void ScaleSequencePlusCore::freeMpeVoice(uint8_t member)
+{
+	MpeVoice& voice(mpe_voices[member]);
+	if (voice.note < 0)
+		return;
+
+	mpe_note_channel[voice.in_channel][voice.note] = -1;
+	voice.note = -1;
+
+	mpe_free[(mpe_free_head + mpe_free_count) % kMpeMemberChannels] = member;
+	mpe_free_count++;
+}
+
+void ScaleSequencePlusCore::stopMpeVoice(uint8_t member, uint32_t frame)
+{
+	if (mpe_voices[member].note < 0)
+		return;
+
+	writeMpeMessage(frame, 0x80 | member, static_cast<uint8_t>(mpe_voices[member].note), 0x40);
+	freeMpeVoice(member);
+}
+
+void ScaleSequencePlusCore::resetMpeVoices()
+{
+	std::memset(mpe_note_channel, -1, sizeof(mpe_note_channel));
+
+	for (uint8_t i = 0; i < kMpeMemberChannels; i++)
+	{
+		mpe_voices[i + 1].note = -1;
+		mpe_voices[i + 1].bend = -1;
+		mpe_free[i] = i + 1;
+	}
+	mpe_free_head = 0;
+	mpe_free_count = kMpeMemberChannels;
+	mpe_steal_cursor = 0;
+}
+
+void ScaleSequencePlusCore::releaseMpeVoices()
+{
+	for (uint8_t ch = 1; ch <= kMpeMemberChannels; ch++)
+	{
+		stopMpeVoice(ch, 0);
+		writeMpeMessage(0, 0xE0 | ch, 0x00, 0x40);
+	}
+	resetMpeVoices();
+}
+
+/**
+   Send the pitch bend for the note on member channel @a member, if it changed.
+   Settled scales use the precomputed cents table, a glide is followed by measuring the current table.
+ */
+void ScaleSequencePlusCore::updateMpeBend(uint8_t member, uint32_t frame, bool gliding)
+{
+	const int32_t note = mpe_voices[member].note;
+
+	double cents = 0.0;
+	if (gliding || fHot.current_scale < 1 || fHot.current_scale > 8)
+		cents = 1200.0 * std::log2(fHot.frequencies[note] / 440.0) - (note - 69) * 100.0;
+	else
+		cents = scale_info[fHot.current_scale]->cents[note];
+
+	double bend = 8192.0 + cents / (mpe_bend_range * 100.0) * 8192.0;
+	if (bend < 0.0)
+		bend = 0.0;
+	else if (bend > 16383.0)
+		bend = 16383.0;
+
+	const int16_t value = static_cast<int16_t>(std::lround(bend));
+	if (value == mpe_voices[member].bend)
+		return;
+
+	mpe_voices[member].bend = value;
+	writeMpeMessage(frame, 0xE0 | member, value & 0x7F, (value >> 7) & 0x7F);
+}
+
+void ScaleSequencePlusCore::writeMpeConfiguration(uint8_t members)
+{
+	// MPE Configuration Message: RPN 6 on the master channel of the lower zone
+	writeMpeMessage(0, 0xB0, 101, 0);
+	writeMpeMessage(0, 0xB0, 100, 6);
+	writeMpeMessage(0, 0xB0, 6, members);
+
+	if (members == 0)
+		return;
+
+	// Pitch bend sensitivity, RPN 0, on every member channel
+	for (uint8_t ch = 1; ch <= members; ch++)
+	{
+		writeMpeMessage(0, 0xB0 | ch, 101, 0);
+		writeMpeMessage(0, 0xB0 | ch, 100, 0);
+		writeMpeMessage(0, 0xB0 | ch, 6, static_cast<uint8_t>(mpe_bend_range));
+		writeMpeMessage(0, 0xB0 | ch, 38, 0);
+	}
+}
+
+void ScaleSequencePlusCore::writeMpeMessage(uint32_t frame, uint8_t status, uint8_t data1, uint8_t data2, uint32_t size)
+{
+	ScaleSequencePlusMidiEvent event;
+	event.frame = frame;
+	event.size = size;
+	event.data[0] = status;
+	event.data[1] = data1;
+	event.data[2] = data2;
+	event.data[3] = 0;
+	event.dataExt = nullptr;
+	sendMidi(event);
+}
+
+void ScaleSequencePlusCore::writeSysEx(const uint8_t* data, uint32_t size)
+{
+	ScaleSequencePlusMidiEvent event;
+	event.frame = switch_frame;
+	event.size = size;
+	event.dataExt = data;
+	sendMidi(event);
+}
+
+/**
+   Every message run() writes goes through here, so that the SysEx output can keep to the DIN rate.
+ */
+void ScaleSequencePlusCore::sendMidi(const ScaleSequencePlusMidiEvent& event)
+{
+	fHost.sendMidiEvent(event);
+	sysex_budget -= event.size;
+}
+
+/**
+   Multi-channel MTS-ESP output.
+   Every channel that is set to a fixed scale, or to follow one lane, gets its own table and glide state. Channels
+   that follow the sequence are left on the global table. Only channels whose table changed during this block
+   are published, once per block, so a channel following a lane switches scale at the start of a block.
+ */
+void ScaleSequencePlusCore::runChannels(uint32_t frames)
+{
+	const bool multiChannel = fHot.parameters[kParameterMultiChannel] > 0.5f;
+
+	// Which channels need a table of their own?
+	uint32_t wanted = 0;
+	if (multiChannel)
+	{
+		for (int32_t ch = 0; ch < kNumChannels; ch++)
+		{
+			if (static_cast<int32_t>(fHot.parameters[kParameterChannel1 + ch]) != 0)
+				wanted |= 1u << ch;
+		}
+	}
+
+	// Switch channels in or out of multi-channel mode
+	const uint32_t toggled = wanted ^ channels_enabled;
+	if (toggled != 0)
+	{
+		for (int32_t ch = 0; ch < kNumChannels; ch++)
+		{
+			if ((toggled & (1u << ch)) == 0)
+				continue;
+
+			if (wanted & (1u << ch))
+			{
+				// Start gliding from wherever the global table is right now
+				std::memcpy(channel_frequencies_in_hz[ch], fHot.frequencies, sizeof(fHot.frequencies));
+				channel_scale[ch] = -1;
+				sink().setMultiChannel(true, static_cast<char>(ch));
+			}
+			else
+			{
+				sink().setMultiChannel(false, static_cast<char>(ch));
+			}
+		}
+		channels_enabled = wanted;
+		note_filter_dirty = true;
+	}
+
+	if (channels_enabled == 0)
+		return;
+
+	// Pick up new targets
+	for (int32_t ch = 0; ch < kNumChannels; ch++)
+	{
+		if ((channels_enabled & (1u << ch)) == 0)
+			continue;
+
+		int32_t slot = static_cast<int32_t>(fHot.parameters[kParameterChannel1 + ch]);
+		if (slot > 8) // following a lane, which keeps the channel where it is while the lane has no scale
+			slot = slot - 9 < activeLanes() ? laneScale(slot - 9) : 0;
+		if (slot == channel_scale[ch])
+			continue;
+
+		if (slot < 1 || slot > 8)
+			continue;
+
+		std::memcpy(channel_target_frequencies_in_hz[ch], scale_info[slot]->frequencies, sizeof(channel_target_frequencies_in_hz[ch]));
+
+		channel_scale[ch] = slot;
+		channels_gliding |= 1u << ch;
+		note_filter_dirty = true;
+	}
+
+	// Glide. The per-frame division used by the global table is applied for the whole block at once,
+	// as channel tables are only published once per block.
+	const uint32_t gliding = channels_gliding & channels_enabled;
+	if (gliding == 0)
+		return;
+
+	const double remaining = glideRemaining(fHot.parameters[kParameterScaleGlide], frames);
+
+	for (int32_t ch = 0; ch < kNumChannels; ch++)
+	{
+		if ((gliding & (1u << ch)) == 0)
+			continue;
+
+		double* const freqs = channel_frequencies_in_hz[ch];
+		const bool converged = glideTable(freqs, channel_target_frequencies_in_hz[ch], remaining);
+
+		sink().setMultiChannelNoteTunings(freqs, static_cast<char>(ch));
+		countPublishes(1);
+
+		if (converged)
+			channels_gliding &= ~(1u << ch);
+	}
+}
+
+/**
+   Bring the MTS-ESP note filter in line with the active scales.
+   Only notes whose mapped/unmapped state differs from what was last published are sent. When no channel
+   is pinned to a scale of its own, a single update is sent for all channels at once.
+ */
+void ScaleSequencePlusCore::publishNoteFilter()
+{
+	note_filter_dirty = false;
+
+	const uint64_t* const global = scale_info[fHot.current_scale]->unmapped;
+
+	if (channels_enabled == 0)
+	{
+		if (note_filter_shared)
+		{
+			publishNoteFilterChanges(note_filter[0], global, -1);
+		}
+		else
+		{
+			for (int32_t ch = 0; ch < kNumChannels; ch++)
+				publishNoteFilterChanges(note_filter[ch], global, static_cast<char>(ch));
+		}
+
+		for (int32_t ch = 1; ch < kNumChannels; ch++)
+		{
+			note_filter[ch][0] = note_filter[0][0];
+			note_filter[ch][1] = note_filter[0][1];
+		}
+		note_filter_shared = true;
+		return;
+	}
+
+	for (int32_t ch = 0; ch < kNumChannels; ch++)
+	{
+		const bool pinned = (channels_enabled & (1u << ch)) != 0 && channel_scale[ch] >= 1 && channel_scale[ch] <= 8;
+		publishNoteFilterChanges(note_filter[ch], pinned ? scale_info[channel_scale[ch]]->unmapped : global, static_cast<char>(ch));
+	}
+	note_filter_shared = false;
+}
+
+void ScaleSequencePlusCore::publishNoteFilterChanges(uint64_t published[2], const uint64_t wanted[2], char channel)
+{
+	for (int32_t word = 0; word < 2; word++)
+	{
+		uint64_t changed = published[word] ^ wanted[word];
+		while (changed != 0)
+		{
+			const int32_t bit = countTrailingZeros(changed);
+			const int32_t note = word * 64 + bit;
+			sink().filterNote(((wanted[word] >> bit) & 1u) != 0, static_cast<char>(note), channel);
+			changed &= changed - 1;
+		}
+		published[word] = wanted[word];
+	}
+}
+
+int32_t ScaleSequencePlusCore::countTrailingZeros(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(x);
+#else
+	int32_t n = 0;
+	while ((x & 1u) == 0)
+	{
+		x >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/**
+   Precompute the table, the MTS-ESP scale name and the bitset of unmapped notes for scale slot 1 to 8, and hand
+   them to run(). This is done whenever a file is loaded, so switching scales in run() only has to copy bits around.
+ */
+void ScaleSequencePlusCore::updateScaleInfo(int32_t scale)
+{
+	const Tunings::Tuning* const tn = tuningForScale(scale);
+	if (tn == nullptr)
+		return;
+
+	ScaleInfo& info = fScaleInfo[scale_info_written[scale]];
+
+	// Use the file name of the scale, without path or extension
+	std::string name(tn->scale.name);
+	name = name.substr(name.find_last_of("/\\") + 1);
+	if (name.size() > 4 && name.compare(name.size() - 4, 4, ".scl") == 0)
+		name.resize(name.size() - 4);
+	if (name.empty())
+		name = tn->scale.description;
+	if (name.empty())
+		name = "12-TET";
+
+	std::snprintf(info.name, sizeof(info.name), "%s", name.c_str());
+
+	for (int32_t i = 0; i < 128; i++)
+		info.frequencies[i] = tn->frequencyForMidiNote(i);
+
+	// MIDI Tuning Standard messages for the scale
+	for (int32_t i = 0; i < 128; i++)
+		encodeMtsFrequency(info.frequencies[i], info.mts_words[i]);
+	buildMtsBulkDump(info.name, info.mts_words, info.bulk_dump);
+
+	// Offsets from 12-TET for MPE pitch bends
+	for (int32_t i = 0; i < 128; i++)
+		info.cents[i] = static_cast<float>(tn->retuningFromEqualInCentsForMidiNote(i));
+
+	info.unmapped[0] = 0;
+	info.unmapped[1] = 0;
+	for (int32_t i = 0; i < 128; i++)
+	{
+		if (!tn->isMidiNoteMapped(i))
+			info.unmapped[i / 64] |= uint64_t(1) << (i % 64);
+	}
+
+	// Hand the buffer over, and write the next update into the one run() gave back last
+	const uint32_t handedOver = scale_info_handover[scale].exchange(scale_info_written[scale] | kScaleInfoFresh,
+	                                                                std::memory_order_acq_rel);
+	scale_info_written[scale] = handedOver & ~kScaleInfoFresh;
+	scale_info_changed.store(true, std::memory_order_release);
+}
+
+/**
+   Take the slots handed over by updateScaleInfo(), at the start of a block. A scale that changed is switched to again,
+   gliding to its new table, and so is every channel on it.
+ */
+void ScaleSequencePlusCore::takeScaleInfo()
+{
+	if (!scale_info_changed.load(std::memory_order_relaxed) || !scale_info_changed.exchange(false, std::memory_order_acquire))
+		return;
+
+	for (int32_t scale = 1; scale <= 8; scale++)
+	{
+		if ((scale_info_handover[scale].load(std::memory_order_relaxed) & kScaleInfoFresh) == 0)
+			continue;
+
+		const uint32_t taken = scale_info_handover[scale].exchange(scale_info_taken[scale], std::memory_order_acq_rel);
+		scale_info_taken[scale] = taken & ~kScaleInfoFresh;
+		scale_info[scale] = &fScaleInfo[scale_info_taken[scale]];
+
+		if (fHot.current_scale == scale)
+			fHot.current_scale = 0;
+		for (int32_t ch = 0; ch < kNumChannels; ch++)
+		{
+			if (channel_scale[ch] == scale)
+				channel_scale[ch] = -1;
+		}
+	}
+}
+
+/**
+   Get the tuning for scale slot 1 to 8, or nullptr for anything else.
+ */
+const Tunings::Tuning* ScaleSequencePlusCore::tuningForScale(int32_t scale) const
+{
+	return scale >= 1 && scale <= 8 ? &fTunings[scale - 1] : nullptr;
+}
+
+Tunings::Tuning* ScaleSequencePlusCore::tuningForScale(int32_t scale)
+{
+	return const_cast<Tunings::Tuning*>(static_cast<const ScaleSequencePlusCore*>(this)->tuningForScale(scale));
+}
+
+#if SCALESEQUENCE_PLUS_PLUGGABLE_SINK
+void ScaleSequencePlusCore::setTuningSink(TuningSink* sink)
+{
+	fSink = sink != nullptr ? sink : &fMtsEsp;
+}
+#endif
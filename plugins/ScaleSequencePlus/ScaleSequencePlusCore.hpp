@@ -0,0 +1,491 @@
+#ifndef SCALESEQUENCE_PLUS_CORE_HPP
+#define SCALESEQUENCE_PLUS_CORE_HPP
+
+#include "ScaleSequencePlusControls.hpp"
+#include "ScaleSequencePlusPerf.hpp"
+#include "ScaleSequencePlusSequencer.hpp"
+#include "ScaleSequencePlusSysEx.hpp"
+#include "ScaleSequencePlusTrace.hpp"
+#include "ScaleSequencePlusTuningSink.hpp"
+#include "Tunings.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// The sequencer itself: step scheduling, scale glide, the eight tuning slots and MTS-ESP publishing.
+// Nothing in here depends on DPF; the plugin (ScaleSequencePlusShared.hpp) feeds it the host's transport and MIDI
+// and hands back what it writes. Built as the scalesequence-core static library.
+//
+// With SCALESEQUENCE_PLUS_FLOAT_GLIDE on, the global glide is worked out in single precision: every note keeps its
+// distance from the target at the start of the glide as a float, and the table is rebuilt from the targets for
+// each frame, so the only doubles written per frame are the ones handed to MTS-ESP. Rounding does not add up over
+// the glide, and published tables stay within 0.01 cents of the double-precision glide. Glides that take a note
+// across more than five octaves are left to the double-precision glide, see startFloatGlide().
+
+#ifndef SCALESEQUENCE_PLUS_FLOAT_GLIDE
+#define SCALESEQUENCE_PLUS_FLOAT_GLIDE 0
+#endif
+
+// -----------------------------------------------------------------------------------------------------------
+
+/**
+   What the plugin found when it loaded a .scl or .kbm file, for display in the UI.
+ */
+struct TuningFileInfo
+{
+    bool valid;          // false if the file was rejected and the tuning was reset
+    char name[128];      // display name
+    int32_t noteCount;   // notes in the scale, or size of the keyboard mapping
+    double period;       // scale period in cents, or octave degrees of the keyboard mapping
+    char error[256];     // message for the user if the file was rejected
+    bool pairReset;      // the rejected file also reset the other file of the slot
+};
+
+/**
+   The tuning table as published at one point in time, for the tuning view.
+   Frequencies are in Hz; the UI works out the cents deviation from 12-TET itself.
+ */
+struct TuningSnapshot
+{
+    int32_t scale;              // scale being glided to, 0 before the first scale switch
+    float current[128];         // frequencies published to MTS-ESP at the end of the block
+    float target[128];          // frequencies of the scale being glided to
+    float origin[128];          // frequencies when the last glide started
+};
+
+/**
+   Single producer, single consumer ring of tuning snapshots, without locks.
+   The UI asks for a snapshot once per frame with request(); the plugin checks wantsWrite() at the end of run()
+   and only then copies its tables, so the audio thread does at most one copy per UI frame.
+   Each slot carries a sequence number that is odd while it is being written (a seqlock), so a reader that
+   gets overtaken by the writer notices and drops the copy instead of showing a torn table.
+ */
+class TuningSnapshotRing
+{
+public:
+    TuningSnapshotRing()
+        : fWritten(0),
+          fRequested(false)
+    {
+        for (uint32_t i = 0; i < kSlots; i++)
+            fSlots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+
+    // UI side
+
+    void request()
+    {
+        fRequested.store(true, std::memory_order_relaxed);
+    }
+
+    /**
+       Copy the newest snapshot into @a out if there is one newer than @a seen. Returns false if there is nothing new
+       or the slot was overwritten during the copy.
+     */
+    bool read(TuningSnapshot& out, uint32_t& seen)
+    {
+        const uint32_t written = fWritten.load(std::memory_order_acquire);
+        if (written == seen)
+            return false;
+
+        Slot& slot(fSlots[(written - 1) % kSlots]);
+
+        const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            return false;
+
+        std::memcpy(&out, &slot.snapshot, sizeof(TuningSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) != before)
+            return false;
+
+        seen = written;
+        return true;
+    }
+
+    // Plugin side
+
+    bool wantsWrite()
+    {
+        return fRequested.load(std::memory_order_relaxed) && fRequested.exchange(false, std::memory_order_relaxed);
+    }
+
+    TuningSnapshot& beginWrite()
+    {
+        Slot& slot(fSlots[fWritten.load(std::memory_order_relaxed) % kSlots]);
+        slot.sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return slot.snapshot;
+    }
+
+    void endWrite()
+    {
+        Slot& slot(fSlots[fWritten.load(std::memory_order_relaxed) % kSlots]);
+        slot.sequence.fetch_add(1, std::memory_order_release);
+        fWritten.fetch_add(1, std::memory_order_release);
+    }
+
+private:
+    static const uint32_t kSlots = 4;
+
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        TuningSnapshot snapshot;
+    };
+
+    Slot fSlots[kSlots];
+    std::atomic<uint32_t> fWritten;
+    std::atomic<bool> fRequested;
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+/**
+   Host transport at the start of a block, the fields of DPF's TimePosition that the sequencer uses.
+   Bars and beats count from 1.
+ */
+struct ScaleSequencePlusTransport
+{
+    bool playing;
+    uint64_t frame;
+
+    struct BarBeatTick {
+        bool valid;
+        int32_t bar;
+        int32_t beat;
+        double tick;
+        double ticksPerBeat;
+        float beatsPerBar;
+        double beatsPerMinute;
+    } bbt;
+};
+
+/**
+   A MIDI event, laid out like DPF's MidiEvent so the plugin can pass its events through without copying.
+   Events longer than 4 bytes (SysEx) are in @a dataExt.
+ */
+struct ScaleSequencePlusMidiEvent
+{
+    static const uint32_t kDataSize = 4;
+
+    uint32_t frame;
+    uint32_t size;
+    uint8_t data[kDataSize];
+    const uint8_t* dataExt;
+};
+
+/**
+   What the core needs from the plugin around it.
+ */
+class ScaleSequencePlusHost
+{
+public:
+    virtual ~ScaleSequencePlusHost() {}
+
+   /**
+      Write a MIDI event to the output. Called from run() only.
+    */
+    virtual void sendMidiEvent(const ScaleSequencePlusMidiEvent& event) = 0;
+
+   /**
+      A .scl or .kbm file was loaded, or reset to the standard tuning. Called from loadScl() and loadKbm().
+    */
+    virtual void tuningFileInfoChanged(States stateId, const TuningFileInfo& info) = 0;
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+class ScaleSequencePlusMasterThread;
+
+class ScaleSequencePlusCore
+{
+public:
+    explicit ScaleSequencePlusCore(ScaleSequencePlusHost& host);
+    ~ScaleSequencePlusCore();
+
+   /**
+      Parameter values, indexed by the Parameters enum. Output parameters (the current step and master status)
+      are updated by run().
+    */
+    float getParameterValue(uint32_t index) const
+    {
+        return fHot.parameters[index];
+    }
+
+    void setParameterValue(uint32_t index, float value)
+    {
+        fHot.parameters[index] = value;
+
+        if (index == kParameterMeasure)
+            fHot.step_mode = static_cast<int32_t>(limit<float>(value, kStepBeats, kStepMidiNote));
+        else if (index == kParameterBypass)
+            fBypassed.store(value >= 0.5f, std::memory_order_relaxed);
+    }
+
+   /**
+      Load a .scl or .kbm file into scale slot 1 to 8. Any other file name, including an empty one, resets that
+      half of the slot to the standard tuning. Not realtime safe; the plugin calls these from setState(), which may
+      run alongside run(). The slot changes for run() at the start of its next block.
+    */
+    void loadScl(int32_t slot, const char* path);
+    void loadKbm(int32_t slot, const char* path);
+
+   /**
+      What loading @a path into state @a stateId would report, without loading anything, for a UI that cannot reach
+      the plugin. A scale is read against the standard mapping, and a mapping against the standard scale.
+    */
+    static TuningFileInfo inspectTuningFile(States stateId, const char* path);
+
+   /**
+      activate() tries to become the MTS-ESP master straight away, and while activated the master thread keeps
+      trying in the background. deactivate() gives the master up.
+    */
+    void activate(double sampleRate);
+    void deactivate();
+
+   /**
+      Process one block. @a midiEvents are passed through to the output, after any tuning SysEx for the block.
+    */
+    void run(uint32_t frames, const ScaleSequencePlusTransport& transport,
+             const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount);
+
+    TuningSnapshotRing& getTuningSnapshots()
+    {
+        return fTuningSnapshots;
+    }
+
+    PerfStats& getPerfStats()
+    {
+        return fPerfStats;
+    }
+
+    const PerfStats& getPerfStats() const
+    {
+        return fPerfStats;
+    }
+
+   /**
+      For offline rendering: glide each stretch of a block between step starts in one go, with glideRemaining() and
+      glideTable(), and publish the table once at its end instead of on every frame. The table at the end of each
+      stretch is the same, up to rounding. Only while deactivated.
+    */
+    void setOfflineGlide(bool offline)
+    {
+        fHot.offline_glide = offline;
+    }
+
+#if SCALESEQUENCE_PLUS_PLUGGABLE_SINK
+   /**
+      Publish to @a sink instead of MTS-ESP, or to MTS-ESP again if null. Only while deactivated.
+      See ScaleSequencePlusTuningSink.hpp.
+    */
+    void setTuningSink(TuningSink* sink);
+#endif
+
+private:
+    // Tuning files
+    void loadScl(Tunings::Tuning& tn, const char* value, States stateId);
+    void loadKbm(Tunings::Tuning& tn, const char* value, States stateId);
+    static void readScl(Tunings::Tuning& tn, const char* value, TuningFileInfo& info);
+    static void readKbm(Tunings::Tuning& tn, const char* value, TuningFileInfo& info);
+    static void describeScl(TuningFileInfo& info, const Tunings::Scale& scale, const char* path);
+    static void describeKbm(TuningFileInfo& info, const Tunings::KeyboardMapping& mapping, const char* path);
+    static void rejectFile(TuningFileInfo& info, const std::exception& e);
+    static void copyFileBaseName(char* dst, std::size_t size, const char* path);
+    static bool endsWith(const char* text, const char* suffix);
+
+    // MTS-ESP master. The master thread registers and deregisters, run() takes over and hands back in between,
+    // and they go through fMasterState:
+    //   kMasterNone -> kMasterRegistered   registered by updateMaster() on the master thread
+    //   kMasterRegistered -> kMasterActive run() has taken over and publishes
+    //   kMasterActive -> kMasterReleased   run() has handed everything back, bypassed
+    //   kMasterReleased -> kMasterNone     deregistered by updateMaster()
+    enum MasterStates : uint32_t {
+        kMasterNone,
+        kMasterRegistered,
+        kMasterActive,
+        kMasterReleased
+    };
+    friend class ScaleSequencePlusMasterThread;
+    bool updateMaster();
+    void updateMasterStatus();
+    void takeOverMaster();
+    void handBackMaster();
+
+    // Processing
+    void transportChanged(TransportChanges change);
+    void countPublishes(uint32_t count);
+    template <StepModes kMode>
+    void runBlock(uint32_t frames, const ScaleSequencePlusTransport& transport, const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount);
+    void startLaneStep(int32_t lane, int32_t step, uint32_t frame);
+    int32_t laneScale(int32_t lane) const;
+    int32_t combinedScale() const;
+    int32_t activeLanes() const;
+    void switchScale(int32_t scale, uint32_t frame);
+    template <bool kConverged>
+    bool runGlide(uint32_t frames);
+#if SCALESEQUENCE_PLUS_FLOAT_GLIDE
+    void startFloatGlide();
+    bool runFloatGlide(uint32_t frames);
+#endif
+    void writeTuningSnapshot();
+    void passMidiThrough(bool mpe, bool gliding, const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount);
+    void runBypassed(const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount);
+    void updateSysExBudget(uint32_t frames);
+    void runSysEx(bool gliding);
+    bool updateMpeStatus();
+    void runMpe(bool gliding, const ScaleSequencePlusMidiEvent* midiEvents, uint32_t midiEventCount);
+    void updateMpeBends(bool gliding);
+    uint8_t allocateMpeVoice(uint32_t frame);
+    void freeMpeVoice(uint8_t member);
+    void stopMpeVoice(uint8_t member, uint32_t frame);
+    void resetMpeVoices();
+    void releaseMpeVoices();
+    void updateMpeBend(uint8_t member, uint32_t frame, bool gliding);
+    void writeMpeConfiguration(uint8_t members);
+    void writeMpeMessage(uint32_t frame, uint8_t status, uint8_t data1, uint8_t data2, uint32_t size = 3);
+    void writeSysEx(const uint8_t* data, uint32_t size);
+    void sendMidi(const ScaleSequencePlusMidiEvent& event);
+    void runChannels(uint32_t frames);
+    void publishNoteFilter();
+    void publishNoteFilterChanges(uint64_t published[2], const uint64_t wanted[2], char channel);
+    static int32_t countTrailingZeros(uint64_t x);
+    void updateScaleInfo(int32_t scale);
+    void takeScaleInfo();
+    const Tunings::Tuning* tuningForScale(int32_t scale) const;
+    Tunings::Tuning* tuningForScale(int32_t scale);
+
+#if SCALESEQUENCE_PLUS_PLUGGABLE_SINK
+    TuningSink& sink() { return *fSink; }
+#else
+    MtsEspTuningSink& sink() { return fMtsEsp; }
+#endif
+
+    ScaleSequencePlusHost& fHost;
+    MtsEspTuningSink fMtsEsp;
+#if SCALESEQUENCE_PLUS_PLUGGABLE_SINK
+    TuningSink* fSink;
+#endif
+    // What every block works on, together on consecutive cache lines ahead of everything else, so that a host
+    // running many instances on one core has as little as possible to bring back into the cache for each.
+    // The two tables come first, each on cache lines of its own.
+    struct alignas(64) HotState {
+        double frequencies[128];          // published to MTS-ESP
+        double targets[128];              // the scale being glided to
+        float parameters[kParameterCount];
+        int32_t step_mode;                // kParameterMeasure as a StepModes value, picks the runBlock() specialization
+        int32_t lane_steps[kNumLanes];    // step each lane is on, -1 before the start
+        uint32_t lane_started[kNumLanes]; // lane_clock when the step of each lane started, for kCombineLastChanged
+        uint32_t lane_clock;              // counts lane step starts
+        TransportTracker transport;
+        TempoRamp tempo;                  // where the steps start within a block, with the tempo changing
+        int32_t current_scale;            // scale being glided to, 0 before the first scale switch
+        bool glide_converged;             // frequencies has reached targets
+        bool snap_to_target;              // just activated, take the targets without gliding
+        bool is_master;                   // fMasterState is kMasterActive, publish to MTS-ESP
+        bool offline_glide;               // see setOfflineGlide()
+#if SCALESEQUENCE_PLUS_FLOAT_GLIDE
+        bool glide_in_float;              // the current glide is done by runFloatGlide()
+        double glide_position;            // how much of glide_offsets is left, 1 at the start of a glide
+        alignas(64) float glide_offsets[128]; // frequencies minus targets when the glide started
+#endif
+    };
+    HotState fHot;
+    static constexpr uint32_t kMaxStepChanges = 32; // lane steps starting within a block, any more are caught up at the next one
+#if SCALESEQUENCE_PLUS_FLOAT_GLIDE
+    static constexpr double kFloatGlideRange = 32.0; // furthest a note may move in a float glide, times its lower end
+#endif
+
+    // The parsed scale slots 1 to 8, kept out of line: each holds several KB of tables, vectors and strings.
+    // Only loadScl() and loadKbm() use them; run() works from scale_info.
+    std::unique_ptr<Tunings::Tuning[]> fTunings;
+
+    double sample_rate;
+
+    // Shared with the master thread, see the MasterStates above
+    std::atomic<uint32_t> fMasterState;
+    std::atomic<bool> fBypassed;
+
+    double glide_origin_in_hz[128]; // where the last glide started, for the tuning view
+
+    // For the UI, see ScaleSequencePlusShared.hpp
+    TuningSnapshotRing fTuningSnapshots;
+    PerfStats fPerfStats;
+
+    // Tracing, see ScaleSequencePlusTrace.hpp
+    TraceWriter fTrace;
+    uint32_t block_publishes;  // tables handed to MTS-ESP in the current block
+    uint64_t trace_frame;      // frames processed since activate()
+    bool trace_gliding;
+
+    // Per scale slot data for run(), precomputed at load time. A file is loaded while run() may be reading the slot,
+    // so each slot has three buffers in fScaleInfo: the one run() reads, the one the loading thread writes, and the
+    // one in between. updateScaleInfo() swaps its finished buffer with the one in between, and run() swaps that one
+    // with its own at the start of the next block, both through scale_info_handover. Buffer 0 is all zeros, for
+    // scale 0.
+    struct ScaleInfo {
+        char name[64];
+        uint64_t unmapped[2]; // bitset of unmapped MIDI notes
+        double frequencies[128];
+        uint8_t mts_words[128][3]; // MIDI Tuning Standard frequency data
+        uint8_t bulk_dump[kMtsBulkDumpSize];
+        float cents[128]; // retuning from 12-TET
+    };
+    static constexpr uint32_t kScaleInfoFresh = 0x80000000u; // handed over, and not taken by run() yet
+    std::unique_ptr<ScaleInfo[]> fScaleInfo;               // 1 + 8 * 3 buffers
+    std::atomic<uint32_t> scale_info_handover[9];          // buffer in between, with kScaleInfoFresh
+    std::atomic<bool> scale_info_changed;                  // a slot was handed over since run() last looked
+    uint32_t scale_info_written[9];                        // buffer the loading thread writes next
+    uint32_t scale_info_taken[9];                          // buffer run() reads
+    const ScaleInfo* scale_info[9];                        // run() side, indexed by scale
+
+    // Note filter as last published, per channel
+    uint64_t note_filter[kNumChannels][2];
+    bool note_filter_shared; // every channel was published with the same filter in one call
+    bool note_filter_dirty;
+
+    // Frame the scale last switched on in the current block, 0 if it didn't; the SysEx and MPE output are stamped with it
+    uint32_t switch_frame;
+
+    // MIDI Tuning Standard SysEx output
+    int32_t sysex_mode;
+    bool sysex_dirty;        // the table changed since it was last sent in full
+    bool sysex_bulk_pending; // a bulk dump is waiting for enough bandwidth
+    uint32_t sysex_cursor;   // note to start from in the next single note message
+    double sysex_budget;     // bytes the MIDI link can take right now
+    uint8_t sysex_sent[128][3];
+    uint8_t sysex_words[128][3];
+    uint8_t sysex_buffer[kMtsNoteChangeMaxSize];
+
+    // MPE output, lower zone: channel 1 (index 0) is the master channel, the rest are member channels.
+    // All voice bookkeeping uses fixed-size tables, so note-on and note-off are O(1).
+    static const uint8_t kMpeMemberChannels = 15;
+    struct MpeVoice {
+        int8_t in_channel; // channel the note came in on
+        int8_t note;       // -1 if the member channel is free
+        int16_t bend;      // last pitch bend sent, -1 if none
+    };
+    bool mpe_active;
+    int32_t mpe_bend_range;
+    MpeVoice mpe_voices[kMpeMemberChannels + 1];   // indexed by member channel
+    int8_t mpe_note_channel[16][128];               // member channel playing an incoming channel and note, or -1
+    uint8_t mpe_free[kMpeMemberChannels];           // ring of free member channels, least recently used first
+    uint32_t mpe_free_head;
+    uint32_t mpe_free_count;
+    uint32_t mpe_steal_cursor;
+
+    // Multi-channel glide state, structure-of-arrays with one cache-aligned row of 128 notes per channel
+    alignas(64) double channel_frequencies_in_hz[kNumChannels][128];
+    alignas(64) double channel_target_frequencies_in_hz[kNumChannels][128];
+    int32_t channel_scale[kNumChannels];
+    uint32_t channels_enabled; // bitmask of channels registered with MTS_SetMultiChannel
+    uint32_t channels_gliding; // bitmask of channels that have not reached their target yet
+
+    ScaleSequencePlusCore(const ScaleSequencePlusCore&) = delete;
+    ScaleSequencePlusCore& operator=(const ScaleSequencePlusCore&) = delete;
+};
+
+#endif
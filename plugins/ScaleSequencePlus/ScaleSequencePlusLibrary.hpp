@@ -0,0 +1,514 @@
+#ifndef SCALESEQUENCE_PLUS_LIBRARY_HPP
+#define SCALESEQUENCE_PLUS_LIBRARY_HPP
+
+#include "Tunings.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+// Index of a library of .scl files for the UI's scale browser.
+// The index is a single file, memory-mapped for reading, so opening the browser costs nothing however large the
+// library is. It is (re)built by ScaleLibraryScanner on background threads; files whose modification time and size
+// haven't changed since the last scan are taken from the old index without being parsed again.
+//
+// Layout: ScaleLibraryHeader, then entryCount ScaleLibraryEntry records, then a block of NUL terminated strings
+// that the entries point into by offset.
+
+static const char kScaleLibraryMagic[8] = { 'S', 'S', 'P', 'S', 'C', 'I', 'D', 'X' };
+static const uint32_t kScaleLibraryVersion = 1;
+
+struct ScaleLibraryHeader
+{
+    char magic[8];          // kScaleLibraryMagic
+    uint32_t version;       // kScaleLibraryVersion
+    uint32_t entrySize;     // sizeof(ScaleLibraryEntry)
+    uint32_t entryCount;
+    uint32_t stringsSize;
+    uint32_t roots;         // string: the directories scanned, separated by ';'
+    uint32_t reserved;
+};
+
+struct ScaleLibraryEntry
+{
+    int64_t mtime;          // file modification time, in the file system's own units
+    uint64_t size;          // file size in bytes
+    uint64_t hash;          // FNV-1a of the file contents, to spot duplicates
+    uint32_t path;          // string: full path of the file
+    uint32_t name;          // string: file name without .scl
+    uint32_t description;   // string: description line from the file
+    int32_t noteCount;
+    double period;          // cents
+    float cents[128];       // each MIDI note's distance from 12-TET with the standard keyboard mapping
+};
+
+/**
+   Read access to an index file, through a memory mapping.
+ */
+class ScaleLibraryIndex
+{
+public:
+    ScaleLibraryIndex()
+        : fData(nullptr),
+          fSize(0)
+#ifdef _WIN32
+        , fFile(INVALID_HANDLE_VALUE),
+          fMapping(nullptr)
+#endif
+    {
+    }
+
+    ~ScaleLibraryIndex()
+    {
+        close();
+    }
+
+    bool open(const std::string& path)
+    {
+        close();
+
+#ifdef _WIN32
+        fFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fFile == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(fFile, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(ScaleLibraryHeader)))
+        {
+            close();
+            return false;
+        }
+
+        fMapping = CreateFileMappingA(fFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        fData = fMapping != nullptr ? static_cast<const uint8_t*>(MapViewOfFile(fMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        fSize = static_cast<size_t>(size.QuadPart);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ScaleLibraryHeader)))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void* const data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        fData = data != MAP_FAILED ? static_cast<const uint8_t*>(data) : nullptr;
+        fSize = static_cast<size_t>(st.st_size);
+#endif
+
+        if (fData == nullptr || !isValid())
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (fData != nullptr)
+            UnmapViewOfFile(fData);
+        if (fMapping != nullptr)
+            CloseHandle(fMapping);
+        if (fFile != INVALID_HANDLE_VALUE)
+            CloseHandle(fFile);
+        fMapping = nullptr;
+        fFile = INVALID_HANDLE_VALUE;
+#else
+        if (fData != nullptr)
+            munmap(const_cast<uint8_t*>(fData), fSize);
+#endif
+        fData = nullptr;
+        fSize = 0;
+    }
+
+    uint32_t getEntryCount() const
+    {
+        return fData != nullptr ? header().entryCount : 0;
+    }
+
+    const ScaleLibraryEntry& getEntry(uint32_t index) const
+    {
+        return reinterpret_cast<const ScaleLibraryEntry*>(fData + sizeof(ScaleLibraryHeader))[index];
+    }
+
+    const char* getString(uint32_t offset) const
+    {
+        return reinterpret_cast<const char*>(fData + stringsOffset() + offset);
+    }
+
+    const char* getRoots() const
+    {
+        return fData != nullptr ? getString(header().roots) : "";
+    }
+
+private:
+    const uint8_t* fData;
+    size_t fSize;
+#ifdef _WIN32
+    HANDLE fFile;
+    HANDLE fMapping;
+#endif
+
+    const ScaleLibraryHeader& header() const
+    {
+        return *reinterpret_cast<const ScaleLibraryHeader*>(fData);
+    }
+
+    size_t stringsOffset() const
+    {
+        return sizeof(ScaleLibraryHeader) + static_cast<size_t>(header().entryCount) * sizeof(ScaleLibraryEntry);
+    }
+
+    // Check everything that is read later, so a truncated or foreign file can't take the UI down
+    bool isValid() const
+    {
+        const ScaleLibraryHeader& h(header());
+        if (std::memcmp(h.magic, kScaleLibraryMagic, sizeof(h.magic)) != 0 || h.version != kScaleLibraryVersion
+            || h.entrySize != sizeof(ScaleLibraryEntry))
+            return false;
+        if (stringsOffset() + h.stringsSize != fSize || h.stringsSize == 0 || fData[fSize - 1] != '\0')
+            return false;
+        if (h.roots >= h.stringsSize)
+            return false;
+
+        for (uint32_t i = 0; i < h.entryCount; i++)
+        {
+            const ScaleLibraryEntry& e(getEntry(i));
+            if (e.path >= h.stringsSize || e.name >= h.stringsSize || e.description >= h.stringsSize)
+                return false;
+        }
+
+        return true;
+    }
+};
+
+/**
+   Where the index lives: the user's cache directory.
+ */
+static inline std::string getScaleLibraryIndexPath()
+{
+    std::filesystem::path dir;
+
+#if defined(_WIN32)
+    if (const char* const local = std::getenv("LOCALAPPDATA"))
+        dir = local;
+#elif defined(__APPLE__)
+    if (const char* const home = std::getenv("HOME"))
+        dir = std::filesystem::path(home) / "Library" / "Caches";
+#else
+    if (const char* const cache = std::getenv("XDG_CACHE_HOME"))
+        dir = cache;
+    else if (const char* const home = std::getenv("HOME"))
+        dir = std::filesystem::path(home) / ".cache";
+#endif
+
+    std::error_code ec;
+    if (dir.empty())
+        dir = std::filesystem::temp_directory_path(ec);
+
+    return (dir / "ScaleSequencePlus" / "scale-library.idx").string();
+}
+
+/**
+   Builds a new index on background threads: one thread walks the directories, then files that are new or changed
+   are parsed by a pool of threads, one per core. The result is written next to the old index and renamed over it,
+   so a reader never sees a half-written file. (Windows won't replace a file that is mapped, so there the reader
+   has to be closed before starting a scan.)
+ */
+class ScaleLibraryScanner
+{
+public:
+    ScaleLibraryScanner()
+        : fRunning(false),
+          fFinished(false),
+          fCancel(false),
+          fFilesFound(0),
+          fFilesParsed(0),
+          fFilesToParse(0)
+    {
+    }
+
+    ~ScaleLibraryScanner()
+    {
+        // Don't keep the editor from closing: give up on the scan and leave the old index in place
+        fCancel.store(true);
+        if (fThread.joinable())
+            fThread.join();
+    }
+
+    /**
+       Start a scan of @a roots (directories separated by ';'), reusing what is still valid in @a previous.
+       Returns false if a scan is already running.
+     */
+    bool start(const std::string& roots, const std::string& indexPath, const ScaleLibraryIndex& previous)
+    {
+        if (fRunning.load())
+            return false;
+        if (fThread.joinable())
+            fThread.join();
+
+        // Take a copy of the old entries: the UI may remap the index while this runs
+        std::vector<Scanned> cached;
+        cached.reserve(previous.getEntryCount());
+        for (uint32_t i = 0; i < previous.getEntryCount(); i++)
+        {
+            const ScaleLibraryEntry& e(previous.getEntry(i));
+            Scanned s;
+            s.entry = e;
+            s.path = previous.getString(e.path);
+            s.name = previous.getString(e.name);
+            s.description = previous.getString(e.description);
+            s.parsed = true;
+            cached.push_back(std::move(s));
+        }
+
+        fFilesFound.store(0);
+        fFilesParsed.store(0);
+        fFilesToParse.store(0);
+        fFinished.store(false);
+        fRunning.store(true);
+        fThread = std::thread(&ScaleLibraryScanner::scan, this, roots, indexPath, std::move(cached));
+        return true;
+    }
+
+    bool isRunning() const
+    {
+        return fRunning.load();
+    }
+
+    /**
+       True once after each scan has finished and the new index is in place.
+     */
+    bool takeFinished()
+    {
+        return fFinished.exchange(false);
+    }
+
+    uint32_t getFilesFound() const { return fFilesFound.load(std::memory_order_relaxed); }
+    uint32_t getFilesParsed() const { return fFilesParsed.load(std::memory_order_relaxed); }
+    uint32_t getFilesToParse() const { return fFilesToParse.load(std::memory_order_relaxed); }
+
+private:
+    struct Scanned
+    {
+        ScaleLibraryEntry entry;
+        std::string path;
+        std::string name;
+        std::string description;
+        bool parsed;
+    };
+
+    std::thread fThread;
+    std::atomic<bool> fRunning;
+    std::atomic<bool> fFinished;
+    std::atomic<bool> fCancel;
+    std::atomic<uint32_t> fFilesFound;
+    std::atomic<uint32_t> fFilesParsed;
+    std::atomic<uint32_t> fFilesToParse;
+
+    static uint64_t hashBytes(const std::string& data)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (const char c : data)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static bool isSclFile(const std::filesystem::path& path)
+    {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+        return ext == ".scl";
+    }
+
+    static void parse(Scanned& s)
+    {
+        try
+        {
+            const Tunings::Scale scale = Tunings::readSCLFile(s.path);
+            const Tunings::Tuning tuning(scale);
+
+            s.description = scale.description;
+            s.entry.hash = hashBytes(scale.rawText);
+            s.entry.noteCount = scale.count;
+            s.entry.period = scale.tones.empty() ? 0.0 : scale.tones.back().cents;
+
+            for (int32_t i = 0; i < 128; i++)
+            {
+                const double equal = 440.0 * std::exp2((i - 69) / 12.0);
+                s.entry.cents[i] = static_cast<float>(1200.0 * std::log2(tuning.frequencyForMidiNote(i) / equal));
+            }
+            s.parsed = true;
+        }
+        catch (const std::exception&)
+        {
+            // Not a usable scale: left out of the index
+            s.parsed = false;
+        }
+    }
+
+    void scan(std::string roots, std::string indexPath, std::vector<Scanned> cached)
+    {
+        std::unordered_map<std::string, const Scanned*> previous;
+        for (const Scanned& s : cached)
+            previous[s.path] = &s;
+
+        // Walk the directories
+        std::vector<Scanned> found;
+        std::vector<size_t> toParse;
+
+        for (size_t start = 0; start <= roots.size();)
+        {
+            const size_t end = std::min(roots.find(';', start), roots.size());
+            const std::string root(roots.substr(start, end - start));
+            start = end + 1;
+            if (root.empty())
+                continue;
+
+            std::error_code ec;
+            for (std::filesystem::recursive_directory_iterator it(root, std::filesystem::directory_options::skip_permission_denied, ec), last;
+                 !ec && it != last && !fCancel.load(std::memory_order_relaxed); it.increment(ec))
+            {
+                if (!it->is_regular_file(ec) || !isSclFile(it->path()))
+                    continue;
+
+                Scanned s;
+                std::memset(&s.entry, 0, sizeof(s.entry));
+                s.path = it->path().string();
+                s.name = it->path().stem().string();
+                s.entry.size = static_cast<uint64_t>(it->file_size(ec));
+                s.entry.mtime = static_cast<int64_t>(it->last_write_time(ec).time_since_epoch().count());
+                s.parsed = false;
+
+                const auto old = previous.find(s.path);
+                if (old != previous.end() && old->second->entry.mtime == s.entry.mtime && old->second->entry.size == s.entry.size)
+                    s = *old->second;
+                else
+                    toParse.push_back(found.size());
+
+                found.push_back(std::move(s));
+                fFilesFound.store(static_cast<uint32_t>(found.size()), std::memory_order_relaxed);
+            }
+        }
+
+        // Parse what is new or changed, in parallel
+        fFilesToParse.store(static_cast<uint32_t>(toParse.size()), std::memory_order_relaxed);
+        std::atomic<size_t> next(0);
+
+        auto worker = [&]() {
+            for (size_t i; !fCancel.load(std::memory_order_relaxed) && (i = next.fetch_add(1)) < toParse.size();)
+            {
+                parse(found[toParse[i]]);
+                fFilesParsed.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+        const uint32_t threadCount = std::max(1u, std::min<uint32_t>(std::thread::hardware_concurrency(), static_cast<uint32_t>(toParse.size())));
+        std::vector<std::thread> pool;
+        for (uint32_t i = 1; i < threadCount; i++)
+            pool.emplace_back(worker);
+        worker();
+        for (std::thread& t : pool)
+            t.join();
+
+        if (fCancel.load())
+        {
+            fRunning.store(false);
+            return;
+        }
+
+        std::sort(found.begin(), found.end(), [](const Scanned& a, const Scanned& b) { return a.name < b.name; });
+
+        write(roots, indexPath, found);
+
+        fRunning.store(false);
+        fFinished.store(true);
+    }
+
+    static void write(const std::string& roots, const std::string& indexPath, std::vector<Scanned>& found)
+    {
+        std::string strings;
+        auto addString = [&strings](const std::string& s) {
+            const uint32_t offset = static_cast<uint32_t>(strings.size());
+            strings.append(s);
+            strings.push_back('\0');
+            return offset;
+        };
+
+        ScaleLibraryHeader header;
+        std::memcpy(header.magic, kScaleLibraryMagic, sizeof(header.magic));
+        header.version = kScaleLibraryVersion;
+        header.entrySize = sizeof(ScaleLibraryEntry);
+        header.entryCount = 0;
+        header.roots = addString(roots);
+        header.reserved = 0;
+
+        std::vector<ScaleLibraryEntry> entries;
+        entries.reserve(found.size());
+        for (Scanned& s : found)
+        {
+            if (!s.parsed)
+                continue;
+            s.entry.path = addString(s.path);
+            s.entry.name = addString(s.name);
+            s.entry.description = addString(s.description);
+            entries.push_back(s.entry);
+        }
+        header.entryCount = static_cast<uint32_t>(entries.size());
+        header.stringsSize = static_cast<uint32_t>(strings.size());
+
+        std::error_code ec;
+        const std::filesystem::path path(indexPath);
+        std::filesystem::create_directories(path.parent_path(), ec);
+
+        const std::string temporary = indexPath + ".tmp";
+        std::FILE* const file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr)
+            return;
+
+        const bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+                          && std::fwrite(entries.data(), sizeof(ScaleLibraryEntry), entries.size(), file) == entries.size()
+                          && std::fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+
+        if (std::fclose(file) == 0 && written)
+            std::filesystem::rename(temporary, path, ec);
+        else
+            std::filesystem::remove(temporary, ec);
+    }
+};
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef SCALESEQUENCE_PLUS_PERF_HPP
+#define SCALESEQUENCE_PLUS_PERF_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+# include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+#endif
+
+// Per-block DSP statistics shown in the UI performance overlay.
+// Build with SCALESEQUENCE_PLUS_PERF_STATS=0 to compile all of it out of run().
+#ifndef SCALESEQUENCE_PLUS_PERF_STATS
+# define SCALESEQUENCE_PLUS_PERF_STATS 1
+#endif
+
+/**
+   Read the CPU's cycle counter, or the closest cheap equivalent on this platform.
+   The rate is not known up front; PerfStats works it out against the steady clock.
+ */
+static inline uint64_t readCycleCounter()
+{
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+static inline int64_t readSteadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+   Totals as read by the UI. Times are in cycle counter ticks; ticksPerSecond converts them.
+ */
+struct PerfStatsSnapshot
+{
+    static const uint32_t kBins = 128;
+
+    uint64_t blocks;
+    uint64_t frames;
+    uint64_t totalTicks;
+    uint64_t maxTicks;
+    uint64_t publishes;     // tuning tables handed to MTS-ESP
+    uint64_t glideFrames;   // frames processed while a glide was running
+    uint32_t lastFrames;    // size of the last block
+    double ticksPerSecond;
+    uint64_t histogram[kBins];
+
+    /**
+       Lower edge of a histogram bin, in ticks. Bins are four to an octave.
+     */
+    static double binTicks(uint32_t bin)
+    {
+        const uint32_t octave = bin / 4;
+        const uint32_t step = bin % 4;
+        return static_cast<double>(uint64_t(1) << octave) * (1.0 + step * 0.25);
+    }
+
+    /**
+       Block time in ticks below which @a fraction of all blocks fall, estimated from the histogram.
+     */
+    double percentileTicks(double fraction) const
+    {
+        if (blocks == 0)
+            return 0.0;
+
+        const double wanted = fraction * static_cast<double>(blocks);
+        uint64_t seen = 0;
+
+        for (uint32_t i = 0; i < kBins; i++)
+        {
+            seen += histogram[i];
+            if (static_cast<double>(seen) >= wanted)
+                return i + 1 < kBins ? binTicks(i + 1) : binTicks(i);
+        }
+
+        return static_cast<double>(maxTicks);
+    }
+};
+
+#if SCALESEQUENCE_PLUS_PERF_STATS
+
+/**
+   Lock-free DSP statistics. The plugin writes from run() with plain relaxed stores (it is the only writer);
+   the UI reads whenever it likes. Readings are not one consistent snapshot, which is fine for a display.
+   Recording a block costs two cycle counter reads and a handful of increments.
+ */
+class PerfStats
+{
+public:
+    static const bool kEnabled = true;
+
+    PerfStats()
+        : fCalibrationTicks(readCycleCounter()),
+          fCalibrationNanoseconds(readSteadyNanoseconds()),
+          fResetRequested(false),
+          fPublishes(0),
+          fGliding(false)
+    {
+        clear();
+    }
+
+    // Plugin side
+
+    uint64_t begin()
+    {
+        if (fResetRequested.load(std::memory_order_relaxed))
+        {
+            clear();
+            fResetRequested.store(false, std::memory_order_relaxed);
+        }
+
+        fPublishes = 0;
+        fGliding = false;
+        return readCycleCounter();
+    }
+
+    void countPublishes(uint32_t count)
+    {
+        fPublishes += count;
+    }
+
+    void setGliding()
+    {
+        fGliding = true;
+    }
+
+    void end(uint64_t start, uint32_t frames)
+    {
+        const uint64_t ticks = readCycleCounter() - start;
+
+        add(fBlocks, 1);
+        add(fFrames, frames);
+        add(fTotalTicks, ticks);
+        add(fPublishesTotal, fPublishes);
+        if (fGliding)
+            add(fGlideFrames, frames);
+        if (ticks > fMaxTicks.load(std::memory_order_relaxed))
+            fMaxTicks.store(ticks, std::memory_order_relaxed);
+        fLastFrames.store(frames, std::memory_order_relaxed);
+        add(fHistogram[bin(ticks)], 1);
+    }
+
+    // UI side
+
+    void requestReset()
+    {
+        fResetRequested.store(true, std::memory_order_relaxed);
+    }
+
+    void read(PerfStatsSnapshot& out) const
+    {
+        out.blocks = fBlocks.load(std::memory_order_relaxed);
+        out.frames = fFrames.load(std::memory_order_relaxed);
+        out.totalTicks = fTotalTicks.load(std::memory_order_relaxed);
+        out.maxTicks = fMaxTicks.load(std::memory_order_relaxed);
+        out.publishes = fPublishesTotal.load(std::memory_order_relaxed);
+        out.glideFrames = fGlideFrames.load(std::memory_order_relaxed);
+        out.lastFrames = fLastFrames.load(std::memory_order_relaxed);
+
+        for (uint32_t i = 0; i < PerfStatsSnapshot::kBins; i++)
+            out.histogram[i] = fHistogram[i].load(std::memory_order_relaxed);
+
+        // The longer the plugin has been running, the better this gets
+        const double ns = static_cast<double>(readSteadyNanoseconds() - fCalibrationNanoseconds);
+        const double ticks = static_cast<double>(readCycleCounter() - fCalibrationTicks);
+        out.ticksPerSecond = ns > 0.0 ? ticks * 1e9 / ns : 0.0;
+    }
+
+private:
+    std::atomic<uint64_t> fBlocks;
+    std::atomic<uint64_t> fFrames;
+    std::atomic<uint64_t> fTotalTicks;
+    std::atomic<uint64_t> fMaxTicks;
+    std::atomic<uint64_t> fPublishesTotal;
+    std::atomic<uint64_t> fGlideFrames;
+    std::atomic<uint32_t> fLastFrames;
+    std::atomic<uint64_t> fHistogram[PerfStatsSnapshot::kBins];
+
+    const uint64_t fCalibrationTicks;
+    const int64_t fCalibrationNanoseconds;
+    std::atomic<bool> fResetRequested;
+
+    // Counts for the block being processed, only touched from run()
+    uint32_t fPublishes;
+    bool fGliding;
+
+    // Single writer, so a load and a store is enough; no locked read-modify-write on the audio thread
+    static void add(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static uint32_t bin(uint64_t ticks)
+    {
+        if (ticks < 2)
+            return 0;
+
+        // Four bins per octave: the octave from the highest set bit, the step from the two bits below it
+        uint32_t octave = 63;
+        while ((ticks >> octave) == 0)
+            --octave;
+
+        const uint32_t step = static_cast<uint32_t>(octave >= 2 ? (ticks >> (octave - 2)) & 3 : (ticks << (2 - octave)) & 3);
+        const uint32_t index = octave * 4 + step;
+        return index < PerfStatsSnapshot::kBins ? index : PerfStatsSnapshot::kBins - 1;
+    }
+
+    void clear()
+    {
+        fBlocks.store(0, std::memory_order_relaxed);
+        fFrames.store(0, std::memory_order_relaxed);
+        fTotalTicks.store(0, std::memory_order_relaxed);
+        fMaxTicks.store(0, std::memory_order_relaxed);
+        fPublishesTotal.store(0, std::memory_order_relaxed);
+        fGlideFrames.store(0, std::memory_order_relaxed);
+        fLastFrames.store(0, std::memory_order_relaxed);
+
+        for (uint32_t i = 0; i < PerfStatsSnapshot::kBins; i++)
+            fHistogram[i].store(0, std::memory_order_relaxed);
+    }
+};
+
+#else
+
+/**
+   Statistics compiled out: every call is empty and the overlay is not offered.
+ */
+class PerfStats
+{
+public:
+    static const bool kEnabled = false;
+
+    uint64_t begin() { return 0; }
+    void countPublishes(uint32_t) {}
+    void setGliding() {}
+    void end(uint64_t, uint32_t) {}
+
+    void requestReset() {}
+    void read(PerfStatsSnapshot& out) const { std::memset(&out, 0, sizeof(out)); }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef SCALESEQUENCE_PLUS_SEQUENCER_HPP
+#define SCALESEQUENCE_PLUS_SEQUENCER_HPP
+
+#include "ScaleSequencePlusControls.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Sequencer arithmetic of the core, apart from it so the tests can work out what it should publish with the same
+// code. Nothing in here depends on DPF.
+
+/**
+   The step within the loop for a step counted from the start of the sequence. Negative before the start.
+ */
+static inline int32_t sequenceStepInLoop(int64_t step, int32_t loopPoint)
+{
+    return static_cast<int32_t>(step % loopPoint);
+}
+
+/**
+   The host tempo across a block. Hosts only give the tempo at the start of a block; while it is ramping, it is taken
+   to go on changing at the rate it did over the last block, so steps starting inside a block are put where the ramp
+   takes them, also with large blocks. A linear ramp is followed exactly.
+ */
+class TempoRamp
+{
+public:
+    TempoRamp()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        fKnown = false;
+        fBeatsPerMinute = 0.0;
+        fSlope = 0.0;
+        fFrames = 0;
+    }
+
+   /**
+      Take in the tempo at the start of a block of @a frames frames. @a continuous is false if the transport
+      started, stopped or jumped, so the last block says nothing about how the tempo moves.
+    */
+    void update(double beatsPerMinute, uint32_t frames, bool continuous)
+    {
+        fSlope = continuous && fKnown && fFrames != 0 ? (beatsPerMinute - fBeatsPerMinute) / fFrames : 0.0;
+        fBeatsPerMinute = beatsPerMinute;
+        fFrames = frames;
+        fKnown = true;
+    }
+
+   /**
+      How many frames into the block @a beats beats will have passed, or -1 if the tempo ramps down to a stop first.
+      The position after f frames is (tempo * f + slope * f^2 / 2) / (60 * sample rate) beats.
+    */
+    double framesForBeats(double beats, double sampleRate) const
+    {
+        const double beatFrames = 60.0 * sampleRate * beats;
+        const double discriminant = fBeatsPerMinute * fBeatsPerMinute + 2.0 * fSlope * beatFrames;
+        if (fBeatsPerMinute <= 0.0 || discriminant < 0.0)
+            return -1.0;
+
+        // The root of the quadratic in the form that does not lose precision when the slope is close to 0
+        return 2.0 * beatFrames / (fBeatsPerMinute + std::sqrt(discriminant));
+    }
+
+private:
+    bool fKnown;
+    double fBeatsPerMinute; // at the start of the current block
+    double fSlope;          // change of the tempo per frame
+    uint32_t fFrames;       // length of the current block
+};
+
+// Host positions as whole ticks of 1/kLaneTicksPerBeat beat for the lane scheduler, so that the step starts of all
+// the lanes are sums of integers, and steps of different lanes that start together start on the same frame
+static const int64_t kLaneTicksPerBeat = 1 << 16;
+
+// How far after a frame a step start can be, in frames, and still be taken as starting on it
+static const double kFrameRounding = 1e-6;
+
+/**
+   Where the steps of a lane start, in ticks: step n starts at origin + n * length.
+ */
+struct LaneGrid
+{
+    int64_t origin;
+    int64_t length;
+};
+
+/**
+   The grid of a lane stepping every @a multiplier beats (@a measure 0) or bars (1), moved by @a offset beats or bars.
+   As with sequencePositionAt(), bar steps always start with a bar: with a whole multiplier, the first bar of the
+   step of bar b is the one found by rounding the offset up.
+ */
+static inline LaneGrid laneGridFor(int32_t measure, float multiplier, float offset, int64_t ticksPerBar)
+{
+    const int64_t steps = std::max<int64_t>(1, std::llround(multiplier));
+
+    if (measure == 1)
+        return { static_cast<int64_t>(std::ceil(offset)) * ticksPerBar, steps * ticksPerBar };
+    return { std::llround(offset * static_cast<double>(kLaneTicksPerBeat)), steps * kLaneTicksPerBeat };
+}
+
+/**
+   A lane step that starts within a block.
+ */
+struct LaneStepChange
+{
+    uint32_t frame;
+    int32_t lane;
+    int32_t step;
+};
+
+/**
+   The steps of the first @a laneCount lanes at host position @a position (in whole ticks, with @a fraction of a tick
+   more) into @a steps, and the steps that start within the next @a frames frames into @a changes, at most
+   @a maxChanges, in the order they start. Returns the number of changes.
+   All the lanes are scheduled in one pass: each round takes the earliest step start of any lane, and every lane
+   starting a step at that tick, so the work grows with the number of lanes and of steps starting in the block,
+   with one tempo lookup per distinct start.
+ */
+static inline uint32_t scheduleLanes(const LaneGrid grids[kNumLanes], const int32_t loopPoints[kNumLanes], int32_t laneCount,
+                                     int64_t position, double fraction, const TempoRamp& tempo, double sampleRate, uint32_t frames,
+                                     int32_t steps[kNumLanes], LaneStepChange* changes, uint32_t maxChanges)
+{
+    int64_t counts[kNumLanes];
+    int64_t next[kNumLanes];
+
+    for (int32_t lane = 0; lane < laneCount; lane++)
+    {
+        // Rounded down, also before the origin
+        const int64_t distance = position - grids[lane].origin;
+        int64_t count = distance / grids[lane].length;
+        if (distance % grids[lane].length < 0)
+            count--;
+
+        counts[lane] = count;
+        next[lane] = grids[lane].origin + (count + 1) * grids[lane].length;
+        steps[lane] = sequenceStepInLoop(count, loopPoints[lane]);
+    }
+
+    uint32_t changeCount = 0;
+    while (changeCount < maxChanges)
+    {
+        int64_t earliest = next[0];
+        for (int32_t lane = 1; lane < laneCount; lane++)
+            earliest = std::min(earliest, next[lane]);
+
+        // The first frame at or after the start. Rounding in the host position can put a start that falls on a frame,
+        // as they all do at 120 bpm and 48 kHz, a hair after it, so that is taken as on the frame.
+        const double frame = std::ceil(tempo.framesForBeats((static_cast<double>(earliest - position) - fraction) / kLaneTicksPerBeat, sampleRate)
+                                       - kFrameRounding);
+        if (frame < 0.0 || frame >= frames)
+            break;
+
+        for (int32_t lane = 0; lane < laneCount && changeCount < maxChanges; lane++)
+        {
+            if (next[lane] != earliest)
+                continue;
+
+            changes[changeCount].frame = static_cast<uint32_t>(frame);
+            changes[changeCount].lane = lane;
+            changes[changeCount].step = sequenceStepInLoop(++counts[lane], loopPoints[lane]);
+            ++changeCount;
+            next[lane] += grids[lane].length;
+        }
+    }
+
+    return changeCount;
+}
+
+/**
+   The step after @a step when stepping on MIDI notes. Before the start of the sequence (-1) that is step 0, and so
+   it is after the last step before the loop point, also when the loop point was just moved below the current step.
+ */
+static inline int32_t nextNoteStep(int32_t step, int32_t loopPoint)
+{
+    return step + 1 < loopPoint ? step + 1 : 0;
+}
+
+// What the host transport did between two blocks, see TransportTracker
+enum TransportChanges {
+    kTransportSteady  = 0, // rolled on from where the last block ended, or stayed stopped
+    kTransportStarted = 1,
+    kTransportStopped = 2,
+    kTransportSeeked  = 3, // moved forwards while playing, or anywhere while stopped
+    kTransportLooped  = 4  // moved backwards while playing
+};
+
+/**
+   Follows the host transport from block to block. Hosts do not say when they loop or seek, so that is told from
+   where a block starts compared to where the last one ended; a jump back while playing is taken to be a loop.
+ */
+class TransportTracker
+{
+public:
+    TransportTracker()
+    {
+        reset();
+    }
+
+   /**
+      Forget the last block. The next one is a start if the transport is playing, and steady if not.
+    */
+    void reset()
+    {
+        fKnown = false;
+        fPlaying = false;
+        fNextFrame = 0;
+        fJump = 0;
+    }
+
+   /**
+      Take in the transport of a block of @a frames frames starting at host frame @a frame.
+    */
+    TransportChanges update(bool playing, uint64_t frame, uint32_t frames)
+    {
+        TransportChanges change = kTransportSteady;
+        fJump = 0;
+
+        if (!fKnown)
+            change = playing ? kTransportStarted : kTransportSteady;
+        else if (playing != fPlaying)
+            change = playing ? kTransportStarted : kTransportStopped;
+        else if (frame != fNextFrame)
+        {
+            fJump = static_cast<int64_t>(frame) - static_cast<int64_t>(fNextFrame);
+            change = playing && fJump < 0 ? kTransportLooped : kTransportSeeked;
+        }
+
+        fKnown = true;
+        fPlaying = playing;
+        fNextFrame = playing ? frame + frames : frame;
+        return change;
+    }
+
+   /**
+      How far the transport jumped in the last block, in frames. 0 unless it seeked or looped.
+    */
+    int64_t getJump() const
+    {
+        return fJump;
+    }
+
+private:
+    bool fKnown;
+    bool fPlaying;
+    uint64_t fNextFrame; // where the next block starts if the transport carries on
+    int64_t fJump;
+};
+
+/**
+   The fraction of the distance to the target left after @a frames frames of glide.
+   Every frame moves 1 / (glide * 1000) of the remaining distance.
+ */
+static inline double glideRemaining(float glide, uint32_t frames)
+{
+    return std::pow(1.0 - 1.0 / (glide * 1000.0), static_cast<double>(frames));
+}
+
+/**
+   Move a 128-note table towards its target by the fraction from glideRemaining().
+   Notes that end up within 0.0001 Hz snap to the target. Returns true if the whole table has arrived.
+ */
+static inline bool glideTable(double freqs[128], const double targets[128], double remaining)
+{
+    bool converged = true;
+
+    for (int32_t i = 0; i < 128; i++)
+    {
+        const double difference = targets[i] - freqs[i];
+        if (std::fabs(difference * remaining) < 0.0001)
+        {
+            freqs[i] = targets[i];
+        }
+        else
+        {
+            freqs[i] = targets[i] - difference * remaining;
+            converged = false;
+        }
+    }
+
+    return converged;
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef SCALESEQUENCE_PLUS_SHARED_HPP
+#define SCALESEQUENCE_PLUS_SHARED_HPP
+
+#include "DistrhoPlugin.hpp"
+#include "ScaleSequencePlusCore.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+START_NAMESPACE_DISTRHO
+
+// -----------------------------------------------------------------------------------------------------------
+
+// DPF's MidiEvent and the core's event type are used interchangeably, see ScaleSequencePlusMidiEvent
+static_assert(sizeof(MidiEvent) == sizeof(ScaleSequencePlusMidiEvent), "MidiEvent layout changed");
+static_assert(MidiEvent::kDataSize == ScaleSequencePlusMidiEvent::kDataSize, "MidiEvent layout changed");
+static_assert(offsetof(MidiEvent, frame) == offsetof(ScaleSequencePlusMidiEvent, frame), "MidiEvent layout changed");
+static_assert(offsetof(MidiEvent, size) == offsetof(ScaleSequencePlusMidiEvent, size), "MidiEvent layout changed");
+static_assert(offsetof(MidiEvent, data) == offsetof(ScaleSequencePlusMidiEvent, data), "MidiEvent layout changed");
+static_assert(offsetof(MidiEvent, dataExt) == offsetof(ScaleSequencePlusMidiEvent, dataExt), "MidiEvent layout changed");
+
+/**
+   The DPF side of the sequencer core (ScaleSequencePlusCore.hpp), and the data the plugin makes available to its UI
+   through direct access (DISTRHO_PLUGIN_WANT_DIRECT_ACCESS).
+   The plugin class derives from this, so the UI can reach it from getPluginInstancePointer().
+   Where the host doesn't allow that, the UI reads the tuning files itself with ScaleSequencePlusCore::inspectTuningFile(),
+   and the tuning view and the performance overlay stay empty.
+   The tuning file info is not touched from run(), so plain locking is fine there.
+   The tuning snapshots and performance statistics are written from run() and are lock-free.
+ */
+class ScaleSequencePlusShared : public Plugin,
+                                private ScaleSequencePlusHost
+{
+public:
+    ScaleSequencePlusShared(uint32_t parameterCount, uint32_t programCount, uint32_t stateCount)
+        : Plugin(parameterCount, programCount, stateCount),
+          fCore(*this),
+          fTuningFileInfoVersion(0)
+    {
+        std::memset(fTuningFileInfo, 0, sizeof(fTuningFileInfo));
+
+        for (int32_t i = 0; i < kStateCount; i++)
+        {
+            fTuningFileInfo[i].valid = true;
+            std::snprintf(fTuningFileInfo[i].name, sizeof(fTuningFileInfo[i].name), "%s", i < kStateFileKBM1 ? "Standard SCL tuning" : "Standard KBM mapping");
+            fTuningFileInfo[i].noteCount = 12;
+            fTuningFileInfo[i].period = i < kStateFileKBM1 ? 1200.0 : 12.0;
+        }
+    }
+
+    /**
+       Get the plugin from the pointer returned by UI::getPluginInstancePointer().
+     */
+    static ScaleSequencePlusShared* fromInstancePointer(void* ptr)
+    {
+        return static_cast<ScaleSequencePlusShared*>(static_cast<Plugin*>(ptr));
+    }
+
+    /**
+       Incremented every time any of the tuning file info changes.
+     */
+    uint32_t getTuningFileInfoVersion() const
+    {
+        return fTuningFileInfoVersion.load(std::memory_order_acquire);
+    }
+
+    /**
+       Copy the info for all states (indexed by the States enum) and return the version they belong to.
+     */
+    uint32_t copyTuningFileInfo(TuningFileInfo info[kStateCount])
+    {
+        const std::lock_guard<std::mutex> lock(fTuningFileInfoMutex);
+
+        std::memcpy(info, fTuningFileInfo, sizeof(fTuningFileInfo));
+        return fTuningFileInfoVersion.load(std::memory_order_relaxed);
+    }
+
+    /**
+       Ask for a tuning snapshot at the end of the next processed block. Called by the UI once per frame.
+     */
+    void requestTuningSnapshot()
+    {
+        fCore.getTuningSnapshots().request();
+    }
+
+    /**
+       Get the newest tuning snapshot if it is newer than @a seen.
+     */
+    bool readTuningSnapshot(TuningSnapshot& snapshot, uint32_t& seen)
+    {
+        return fCore.getTuningSnapshots().read(snapshot, seen);
+    }
+
+    /**
+       DSP statistics for the performance overlay. All zero if built without SCALESEQUENCE_PLUS_PERF_STATS.
+     */
+    void readPerfStats(PerfStatsSnapshot& stats) const
+    {
+        fCore.getPerfStats().read(stats);
+    }
+
+    void resetPerfStats()
+    {
+        fCore.getPerfStats().requestReset();
+    }
+
+protected:
+    ScaleSequencePlusCore fCore;
+
+    /**
+       Hand the host's position to the core and process a block.
+     */
+    void runCore(uint32_t frames, const MidiEvent* midiEvents, uint32_t midiEventCount)
+    {
+        const TimePosition& timePos(getTimePosition());
+
+        ScaleSequencePlusTransport transport;
+        transport.playing = timePos.playing;
+        transport.frame = timePos.frame;
+        transport.bbt.valid = timePos.bbt.valid;
+        transport.bbt.bar = timePos.bbt.bar;
+        transport.bbt.beat = timePos.bbt.beat;
+        transport.bbt.tick = timePos.bbt.tick;
+        transport.bbt.ticksPerBeat = timePos.bbt.ticksPerBeat;
+        transport.bbt.beatsPerBar = timePos.bbt.beatsPerBar;
+        transport.bbt.beatsPerMinute = timePos.bbt.beatsPerMinute;
+
+        fCore.run(frames, transport, reinterpret_cast<const ScaleSequencePlusMidiEvent*>(midiEvents), midiEventCount);
+    }
+
+private:
+    void sendMidiEvent(const ScaleSequencePlusMidiEvent& event) override
+    {
+        writeMidiEvent(reinterpret_cast<const MidiEvent&>(event));
+    }
+
+    void tuningFileInfoChanged(States stateId, const TuningFileInfo& info) override
+    {
+        if (info.pairReset)
+            d_stdout("ScaleSequence-Plus: %s", info.error);
+
+        const std::lock_guard<std::mutex> lock(fTuningFileInfoMutex);
+
+        fTuningFileInfo[stateId] = info;
+        fTuningFileInfoVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    std::mutex fTuningFileInfoMutex;
+    std::atomic<uint32_t> fTuningFileInfoVersion;
+    TuningFileInfo fTuningFileInfo[kStateCount];
+
+    DISTRHO_DECLARE_NON_COPYABLE(ScaleSequencePlusShared)
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef SCALESEQUENCE_PLUS_SHM_SINK_HPP
+#define SCALESEQUENCE_PLUS_SHM_SINK_HPP
+
+#include "ScaleSequencePlusTuningSink.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// A stand-in for libMTS for integration tests: the tuning is kept in a named block of shared memory, the way libMTS
+// shares it between the master and its clients, so a test client in another process can check what was published
+// without MTS-ESP installed. ShmTuningSink is the master side, ShmTuningClient the client side; see
+// tests/shm-sink-tests.cpp.
+//
+// Tables are written under a sequence number that is odd while a write is in progress (a seqlock), so a client
+// never sees a half-written table. The block is zero-filled when it is first created; a master that finds it
+// empty writes the header.
+
+static const char kShmTuningMagic[8] = { 'S', 'S', 'P', 'M', 'T', 'S', 'S', 'M' };
+static const uint32_t kShmTuningVersion = 2;
+
+struct ShmTuningState
+{
+    char magic[8];                     // kShmTuningMagic
+    uint32_t version;                  // kShmTuningVersion
+    std::atomic<uint32_t> master;      // 1 while a master is registered
+    std::atomic<uint32_t> sequence;    // odd while the fields below are being written
+    uint32_t multiChannel;             // bitmask of channels with a table of their own
+    char scaleName[64];
+    uint64_t filter[16][2];            // filtered notes, per channel
+    double table[128];
+    double channelTables[16][128];
+};
+
+/**
+   Maps the named block, creating it if needed. Shared by the sink and the client.
+ */
+class ShmTuningMapping
+{
+public:
+    ShmTuningMapping()
+        : fState(nullptr)
+#ifdef _WIN32
+        , fMapping(nullptr)
+#endif
+    {
+    }
+
+    ~ShmTuningMapping()
+    {
+        close();
+    }
+
+   /**
+      Open the block called @a name, e.g. "/scalesequence-test". Returns false if it could not be mapped.
+    */
+    bool open(const char* name)
+    {
+        close();
+
+#ifdef _WIN32
+        fMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(ShmTuningState), name);
+        if (fMapping == nullptr)
+            return false;
+        fState = static_cast<ShmTuningState*>(MapViewOfFile(fMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ShmTuningState)));
+#else
+        const int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+        if (fd < 0)
+            return false;
+
+        void* data = MAP_FAILED;
+        if (ftruncate(fd, sizeof(ShmTuningState)) == 0)
+            data = mmap(nullptr, sizeof(ShmTuningState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        fState = data != MAP_FAILED ? static_cast<ShmTuningState*>(data) : nullptr;
+#endif
+
+        if (fState == nullptr)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (fState != nullptr)
+            UnmapViewOfFile(fState);
+        if (fMapping != nullptr)
+            CloseHandle(fMapping);
+        fMapping = nullptr;
+#else
+        if (fState != nullptr)
+            munmap(fState, sizeof(ShmTuningState));
+#endif
+        fState = nullptr;
+    }
+
+    ShmTuningState* get() const
+    {
+        return fState;
+    }
+
+   /**
+      Remove the name, so the next open() starts from an empty block. Clients that have it open keep their mapping.
+    */
+    static void unlink(const char* name)
+    {
+#ifndef _WIN32
+        shm_unlink(name);
+#else
+        (void)name;
+#endif
+    }
+
+private:
+    ShmTuningState* fState;
+#ifdef _WIN32
+    HANDLE fMapping;
+#endif
+
+    ShmTuningMapping(const ShmTuningMapping&) = delete;
+    ShmTuningMapping& operator=(const ShmTuningMapping&) = delete;
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+/**
+   The master side. Calls do nothing if the block could not be opened, and registerMaster() fails.
+ */
+class ShmTuningSink final : public TuningSink
+{
+public:
+    explicit ShmTuningSink(const char* name)
+    {
+        if (!fMapping.open(name))
+            return;
+
+        ShmTuningState& s(*fMapping.get());
+        if (std::memcmp(s.magic, kShmTuningMagic, sizeof(s.magic)) != 0)
+        {
+            s.version = kShmTuningVersion;
+            std::memcpy(s.magic, kShmTuningMagic, sizeof(s.magic));
+        }
+    }
+
+    bool isOpen() const
+    {
+        return fMapping.get() != nullptr;
+    }
+
+    bool registerMaster(const void*) override
+    {
+        uint32_t expected = 0;
+        return isOpen() && fMapping.get()->master.compare_exchange_strong(expected, 1);
+    }
+
+    void deregisterMaster() override
+    {
+        if (!isOpen())
+            return;
+        fMapping.get()->master.store(0);
+    }
+
+    void setNoteTunings(const double freqs[128]) override
+    {
+        if (ShmTuningState* const s = beginWrite())
+        {
+            std::memcpy(s->table, freqs, sizeof(s->table));
+            endWrite(s);
+        }
+    }
+
+    void setScaleName(const char* name) override
+    {
+        if (ShmTuningState* const s = beginWrite())
+        {
+            std::snprintf(s->scaleName, sizeof(s->scaleName), "%s", name);
+            endWrite(s);
+        }
+    }
+
+    void filterNote(bool doFilter, char note, char channel) override
+    {
+        if (ShmTuningState* const s = beginWrite())
+        {
+            const uint64_t bit = uint64_t(1) << (note % 64);
+            for (int32_t ch = 0; ch < 16; ch++)
+            {
+                if (channel >= 0 && ch != channel)
+                    continue;
+                if (doFilter)
+                    s->filter[ch][note / 64] |= bit;
+                else
+                    s->filter[ch][note / 64] &= ~bit;
+            }
+            endWrite(s);
+        }
+    }
+
+    void clearNoteFilter() override
+    {
+        if (ShmTuningState* const s = beginWrite())
+        {
+            std::memset(s->filter, 0, sizeof(s->filter));
+            endWrite(s);
+        }
+    }
+
+    void setMultiChannel(bool set, char channel) override
+    {
+        if (ShmTuningState* const s = beginWrite())
+        {
+            if (set)
+                s->multiChannel |= 1u << channel;
+            else
+                s->multiChannel &= ~(1u << channel);
+            endWrite(s);
+        }
+    }
+
+    void setMultiChannelNoteTunings(const double freqs[128], char channel) override
+    {
+        if (ShmTuningState* const s = beginWrite())
+        {
+            std::memcpy(s->channelTables[static_cast<uint8_t>(channel)], freqs, sizeof(s->channelTables[0]));
+            endWrite(s);
+        }
+    }
+
+private:
+    ShmTuningMapping fMapping;
+
+    ShmTuningState* beginWrite()
+    {
+        ShmTuningState* const s = fMapping.get();
+        if (s == nullptr)
+            return nullptr;
+        s->sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return s;
+    }
+
+    static void endWrite(ShmTuningState* s)
+    {
+        s->sequence.fetch_add(1, std::memory_order_release);
+    }
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+/**
+   The client side: takes consistent copies of what the master published.
+ */
+class ShmTuningClient
+{
+public:
+    bool open(const char* name)
+    {
+        return fMapping.open(name);
+    }
+
+    bool hasMaster() const
+    {
+        return fMapping.get() != nullptr && fMapping.get()->master.load() != 0;
+    }
+
+   /**
+      Copy the whole state into @a out. Returns false if the block is not open or not set up by a master yet,
+      or if the master kept writing through every attempt.
+    */
+    bool read(ShmTuningState& out) const
+    {
+        const ShmTuningState* const s = fMapping.get();
+        if (s == nullptr || std::memcmp(s->magic, kShmTuningMagic, sizeof(s->magic)) != 0 || s->version != kShmTuningVersion)
+            return false;
+
+        for (int32_t attempt = 0; attempt < 100; attempt++)
+        {
+            const uint32_t before = s->sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;
+
+            std::memcpy(static_cast<void*>(&out), s, sizeof(ShmTuningState));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (s->sequence.load(std::memory_order_relaxed) == before)
+                return true;
+        }
+        return false;
+    }
+
+private:
+    ShmTuningMapping fMapping;
+};
+
+#endif
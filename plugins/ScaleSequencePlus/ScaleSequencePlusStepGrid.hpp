@@ -0,0 +1,91 @@
+#ifndef SCALESEQUENCE_PLUS_STEP_GRID_HPP
+#define SCALESEQUENCE_PLUS_STEP_GRID_HPP
+
+#include "ScaleSequencePlusControls.hpp"
+
+#include <cstdint>
+
+// The step buttons of the sequence pane. They are drawn every frame for every open editor, so they are kept apart
+// from the rest of the UI and depend on nothing but Dear ImGui, which has to be included first. That way
+// tests/step-grid-tests.cpp can draw them without DPF or a renderer and check that they allocate nothing.
+
+// Button labels for a scale choice, indexed by parameter value
+static const char* const kScaleLabels[9] = { "0", "1", "2", "3", "4", "5", "6", "7", "8" };
+static const char* const kLaneStepLabels[9] = { "-", "1", "2", "3", "4", "5", "6", "7", "8" };
+
+/**
+   Where drawStepGrid() sends the steps the user clicks.
+ */
+class StepGridEditor
+{
+public:
+    virtual ~StepGridEditor() {}
+
+   /**
+      A click on step parameter @a index started or ended, for host automation.
+    */
+    virtual void editStep(uint32_t index, bool started) = 0;
+
+   /**
+      Step parameter @a index was set to @a value, which is already in the parameters given to drawStepGrid().
+    */
+    virtual void setStep(uint32_t index, float value) = 0;
+};
+
+/**
+   Draw the steps of @a lane from @a parameters in rows of kStepsPerRow, with the current step in @a highlight.
+   Clicking a step moves it on to the next scale, then back to the first, which is "off" for lanes 2 to 4.
+   The labels are static and each button's ID is pushed as an integer, so nothing is allocated per frame.
+ */
+static inline void drawStepGrid(float parameters[kParameterCount], int32_t lane, const ImVec2& buttonSize,
+                                const ImVec4& highlight, StepGridEditor& editor)
+{
+    // Steps are numbered from 1 in the current step outputs, 0 means no step yet. Lane 1 always has a scale
+    // on every step, the other lanes can leave a step off.
+    const int32_t current_step = static_cast<int32_t>(parameters[laneParameter(lane, kLaneCurrentStep)] / 0.03125f) - 1;
+    const uint32_t first_scale = lane == 0 ? 1 : 0;
+    const char* const* const step_labels = lane == 0 ? kScaleLabels : kLaneStepLabels;
+
+    for (int32_t step = 0; step < kNumSteps; step++)
+    {
+        const uint32_t index = laneParameter(lane, kLaneStep1 + step);
+        const bool highlighted = step == current_step;
+
+        if (step % kStepsPerRow != 0)
+            ImGui::SameLine();
+
+        ImGui::PushID(step);
+
+        if (highlighted)
+        {
+            ImGui::PushStyleColor(ImGuiCol_Button, highlight);
+        }
+
+        if (ImGui::Button(step_labels[static_cast<uint32_t>(parameters[index])], buttonSize))
+        {
+            if (ImGui::IsItemActivated())
+                editor.editStep(index, true);
+
+            uint32_t cur_val = static_cast<uint32_t>(parameters[index]);
+            cur_val += 1;
+            if (cur_val > 8)
+                cur_val = first_scale;
+            parameters[index] = static_cast<float>(cur_val);
+            editor.setStep(index, parameters[index]);
+        }
+
+        if (highlighted)
+        {
+            ImGui::PopStyleColor();
+        }
+
+        if (ImGui::IsItemDeactivated())
+        {
+            editor.editStep(index, false);
+        }
+
+        ImGui::PopID();
+    }
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef SCALESEQUENCE_PLUS_SYSEX_HPP
+#define SCALESEQUENCE_PLUS_SYSEX_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// MIDI Tuning Standard messages, as described in the MIDI 1.0 specification (MMA CA-020 / CA-021)
+
+static const uint8_t kMtsDeviceId = 0x7F; // all call
+static const uint8_t kMtsProgram  = 0x00;
+
+// F0 7F <device> 08 02 <program> <count> [<key> <xx> <yy> <zz>] ... F7
+static const uint32_t kMtsNoteChangeHeaderSize = 7;
+static const uint32_t kMtsNoteChangeMaxNotes   = 127;
+static const uint32_t kMtsNoteChangeMaxSize    = kMtsNoteChangeHeaderSize + 4 * kMtsNoteChangeMaxNotes + 1;
+
+// F0 7E <device> 08 01 <program> <name x16> [<xx> <yy> <zz>] x128 <checksum> F7
+static const uint32_t kMtsBulkDumpSize = 6 + 16 + 128 * 3 + 2;
+
+// A 5-pin DIN MIDI link runs at 31250 baud, 10 bits per byte
+static const double kMidiDinBytesPerSecond = 31250.0 / 10.0;
+
+/**
+   Encode a frequency as MTS frequency data: the equal-tempered semitone at or below the frequency,
+   followed by a 14-bit fraction of a semitone. Frequencies outside the MIDI note range are clamped.
+ */
+static inline void encodeMtsFrequency(double hz, uint8_t out[3])
+{
+    double semitones = 69.0 + 12.0 * std::log2(hz / 440.0);
+
+    if (!(semitones > 0.0)) // also catches NaN
+        semitones = 0.0;
+
+    int32_t note = static_cast<int32_t>(semitones);
+    int32_t fraction = static_cast<int32_t>(std::lround((semitones - note) * 16384.0));
+
+    if (fraction >= 16384)
+    {
+        note += 1;
+        fraction = 0;
+    }
+
+    if (note > 127 || (note == 127 && fraction >= 16383))
+    {
+        // 7F 7F 7F is reserved for "no change", so stop just short of it
+        out[0] = 0x7F;
+        out[1] = 0x7F;
+        out[2] = 0x7E;
+        return;
+    }
+
+    out[0] = static_cast<uint8_t>(note);
+    out[1] = static_cast<uint8_t>((fraction >> 7) & 0x7F);
+    out[2] = static_cast<uint8_t>(fraction & 0x7F);
+}
+
+/**
+   Write a complete bulk tuning dump for 128 notes into @a out, which must hold kMtsBulkDumpSize bytes.
+   The name is padded with spaces (or truncated) to 16 characters.
+ */
+static inline void buildMtsBulkDump(const char* name, const uint8_t words[128][3], uint8_t out[kMtsBulkDumpSize])
+{
+    uint32_t pos = 0;
+
+    out[pos++] = 0xF0;
+    out[pos++] = 0x7E;
+    out[pos++] = kMtsDeviceId;
+    out[pos++] = 0x08;
+    out[pos++] = 0x01;
+    out[pos++] = kMtsProgram;
+
+    bool ended = false;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        if (name[i] == '\0')
+            ended = true;
+        const char c = ended ? ' ' : name[i];
+        out[pos++] = (c >= 0x20 && c < 0x7F) ? static_cast<uint8_t>(c) : '_';
+    }
+
+    for (uint32_t i = 0; i < 128; i++)
+    {
+        out[pos++] = words[i][0];
+        out[pos++] = words[i][1];
+        out[pos++] = words[i][2];
+    }
+
+    // XOR of everything between F0 and the checksum
+    uint8_t checksum = 0;
+    for (uint32_t i = 1; i < pos; i++)
+        checksum ^= out[i];
+
+    out[pos++] = checksum & 0x7F;
+    out[pos++] = 0xF7;
+}
+
+/**
+   Start a real-time single note tuning change message in @a out. Returns the position of the first note entry.
+   Use appendMtsNoteChange() for each note and finishMtsNoteChange() to close the message.
+ */
+static inline uint32_t beginMtsNoteChange(uint8_t* out)
+{
+    out[0] = 0xF0;
+    out[1] = 0x7F;
+    out[2] = kMtsDeviceId;
+    out[3] = 0x08;
+    out[4] = 0x02;
+    out[5] = kMtsProgram;
+    out[6] = 0; // note count, filled in by finishMtsNoteChange()
+    return kMtsNoteChangeHeaderSize;
+}
+
+static inline uint32_t appendMtsNoteChange(uint8_t* out, uint32_t pos, uint8_t note, const uint8_t word[3])
+{
+    out[pos++] = note;
+    out[pos++] = word[0];
+    out[pos++] = word[1];
+    out[pos++] = word[2];
+    return pos;
+}
+
+static inline uint32_t finishMtsNoteChange(uint8_t* out, uint32_t pos)
+{
+    out[6] = static_cast<uint8_t>((pos - kMtsNoteChangeHeaderSize) / 4);
+    out[pos++] = 0xF7;
+    return pos;
+}
+
+#endif
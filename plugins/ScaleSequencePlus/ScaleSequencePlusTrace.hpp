@@ -0,0 +1,220 @@
+#ifndef SCALESEQUENCE_PLUS_TRACE_HPP
+#define SCALESEQUENCE_PLUS_TRACE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+// Trace events for offline timing analysis. Tracing is switched on at run time by setting the environment variable
+// SCALESEQUENCE_PLUS_TRACE_FILE to the path of the file to write. Each instance appends its own number to the path.
+// Build with SCALESEQUENCE_PLUS_TRACE=0 to compile all of it out of run().
+#ifndef SCALESEQUENCE_PLUS_TRACE
+# define SCALESEQUENCE_PLUS_TRACE 1
+#endif
+
+enum TraceEventType {
+    kTraceActivate       = 0, // value: sample rate in Hz. Frame positions start again from 0
+    kTraceStep           = 1, // value: step index, -1 before the start
+    kTraceScaleSwitch    = 2, // value: scale 1 to 8
+    kTraceGlideStart     = 3,
+    kTraceGlideEnd       = 4,
+    kTracePublish        = 5, // value: tables handed to MTS-ESP in the block
+    kTraceMidiTrigger    = 6, // value: note number of the note on that advanced the step
+    kTraceTransportJump  = 7, // value: distance jumped, in frames (clamped to 32 bits), on a seek or loop
+    kTraceTransportStart = 8,
+    kTraceTransportStop  = 9,
+    kTraceDropped        = 10, // written last, value: events lost because the file writer fell behind
+    kTraceLaneStep       = 11, // value: lane number (2 to 4) times 256, plus the step index + 1 (0 before the start)
+    kTraceEventTypeCount = 12
+};
+
+static const char* const kTraceEventNames[kTraceEventTypeCount] = {
+    "activate",
+    "step",
+    "scale switch",
+    "glide start",
+    "glide end",
+    "publish",
+    "midi trigger",
+    "transport jump",
+    "transport start",
+    "transport stop",
+    "dropped",
+    "lane step",
+};
+
+/**
+   One event as stored in the ring and in the file (little endian, 16 bytes).
+ */
+struct TraceEvent
+{
+    uint64_t frame;      // frames since the last kTraceActivate
+    uint32_t type;       // TraceEventType
+    int32_t value;
+};
+
+// The file starts with this header, followed by TraceEvent records up to the end of the file
+struct TraceFileHeader
+{
+    char magic[8];       // kTraceFileMagic
+    uint32_t version;    // kTraceFileVersion
+    uint32_t eventSize;  // sizeof(TraceEvent)
+};
+
+static const char kTraceFileMagic[8] = { 'S', 'S', 'P', 'T', 'R', 'A', 'C', 'E' };
+static const uint32_t kTraceFileVersion = 1;
+
+#if SCALESEQUENCE_PLUS_TRACE
+
+/**
+   Trace events from run(), drained to a file by a background thread.
+   The ring is single producer (the audio thread), single consumer (the drain thread). Events that don't fit
+   because the drain thread fell behind are dropped and counted, never waited for.
+   The ring is only allocated once the file is open, so an instance that isn't traced carries none of it.
+ */
+class TraceWriter
+{
+public:
+    static const bool kEnabled = true;
+
+    TraceWriter()
+        : fFile(nullptr),
+          fHead(0),
+          fTail(0),
+          fDropped(0),
+          fRunning(false)
+    {
+        const char* const path = std::getenv("SCALESEQUENCE_PLUS_TRACE_FILE");
+        if (path == nullptr || path[0] == '\0')
+            return;
+
+        static std::atomic<uint32_t> sInstanceCount(0);
+        char filename[1024];
+        std::snprintf(filename, sizeof(filename), "%s.%u", path, sInstanceCount.fetch_add(1));
+
+        fFile = std::fopen(filename, "wb");
+        if (fFile == nullptr)
+            return;
+
+        fEvents.reset(new TraceEvent[kCapacity]);
+
+        TraceFileHeader header;
+        std::memcpy(header.magic, kTraceFileMagic, sizeof(header.magic));
+        header.version = kTraceFileVersion;
+        header.eventSize = sizeof(TraceEvent);
+        std::fwrite(&header, sizeof(header), 1, fFile);
+
+        fRunning.store(true);
+        fThread = std::thread(&TraceWriter::drainLoop, this);
+    }
+
+    ~TraceWriter()
+    {
+        if (fFile == nullptr)
+            return;
+
+        fRunning.store(false);
+        fThread.join();
+        drain();
+
+        if (const uint32_t dropped = fDropped.load())
+        {
+            TraceEvent event;
+            event.frame = 0;
+            event.type = kTraceDropped;
+            event.value = static_cast<int32_t>(dropped);
+            std::fwrite(&event, sizeof(event), 1, fFile);
+        }
+
+        std::fclose(fFile);
+    }
+
+    bool isActive() const
+    {
+        return fFile != nullptr;
+    }
+
+    /**
+       Record an event. Audio thread only.
+     */
+    void add(TraceEventType type, uint64_t frame, int32_t value = 0)
+    {
+        if (fFile == nullptr)
+            return;
+
+        const uint32_t head = fHead.load(std::memory_order_relaxed);
+        if (head - fTail.load(std::memory_order_acquire) >= kCapacity)
+        {
+            fDropped.store(fDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+
+        TraceEvent& event(fEvents[head & (kCapacity - 1)]);
+        event.frame = frame;
+        event.type = type;
+        event.value = value;
+        fHead.store(head + 1, std::memory_order_release);
+    }
+
+private:
+    static constexpr uint32_t kCapacity = 8192; // power of two
+
+    std::FILE* fFile;
+    std::thread fThread;
+    std::unique_ptr<TraceEvent[]> fEvents; // kCapacity events, while fFile is open
+    std::atomic<uint32_t> fHead;
+    std::atomic<uint32_t> fTail;
+    std::atomic<uint32_t> fDropped;
+    std::atomic<bool> fRunning;
+
+    void drainLoop()
+    {
+        while (fRunning.load())
+        {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+    void drain()
+    {
+        const uint32_t head = fHead.load(std::memory_order_acquire);
+        uint32_t tail = fTail.load(std::memory_order_relaxed);
+
+        while (tail != head)
+        {
+            // Write the contiguous part of the ring in one go
+            const uint32_t start = tail & (kCapacity - 1);
+            const uint32_t count = std::min(head - tail, kCapacity - start);
+            std::fwrite(&fEvents[start], sizeof(TraceEvent), count, fFile);
+            tail += count;
+        }
+
+        fTail.store(tail, std::memory_order_release);
+        std::fflush(fFile);
+    }
+};
+
+#else
+
+/**
+   Tracing compiled out: every call is empty.
+ */
+class TraceWriter
+{
+public:
+    static const bool kEnabled = false;
+
+    bool isActive() const { return false; }
+    void add(TraceEventType, uint64_t, int32_t = 0) {}
+};
+
+#endif
+
+#endif
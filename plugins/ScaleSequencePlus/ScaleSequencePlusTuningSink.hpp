@@ -0,0 +1,291 @@
+#ifndef SCALESEQUENCE_PLUS_TUNING_SINK_HPP
+#define SCALESEQUENCE_PLUS_TUNING_SINK_HPP
+
+#include "libMTSMaster.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Where the core publishes its tuning tables. The plugin publishes to MTS-ESP; tools and tests publish to one of the
+// other sinks instead, so measuring run() does not also measure libMTS, and checking its output does not need it.
+//
+// With SCALESEQUENCE_PLUS_PLUGGABLE_SINK off (release builds, by default) the core holds an MtsEspTuningSink
+// directly. It is final, so every call is bound at compile time and inlined, and the interface costs nothing.
+// With it on, the core publishes through a TuningSink pointer that can be changed with setTuningSink(). Tools and
+// tests link the scalesequence-core-pluggable library, which always has it on.
+
+#ifndef SCALESEQUENCE_PLUS_PLUGGABLE_SINK
+#define SCALESEQUENCE_PLUS_PLUGGABLE_SINK 0
+#endif
+
+/**
+   The calls the core makes on libMTSMaster. Channels are 0 to 15, or -1 for all channels.
+   registerMaster() and deregisterMaster() come from the core's master thread, everything else from run(), but never
+   at the same time: run() only publishes between the two.
+ */
+class TuningSink
+{
+public:
+    virtual ~TuningSink() {}
+
+   /**
+      Become the master, unless someone else is. @a owner is the core asking.
+    */
+    virtual bool registerMaster(const void* owner) = 0;
+    virtual void deregisterMaster() = 0;
+
+    virtual void setNoteTunings(const double freqs[128]) = 0;
+    virtual void setScaleName(const char* name) = 0;
+    virtual void filterNote(bool doFilter, char note, char channel) = 0;
+    virtual void clearNoteFilter() = 0;
+    virtual void setMultiChannel(bool set, char channel) = 0;
+    virtual void setMultiChannelNoteTunings(const double freqs[128], char channel) = 0;
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+/**
+   The real MTS-ESP master, through libMTSMaster.
+   Only one master can be registered at a time. Cores living in the same process arbitrate through sMasterInstance
+   before asking libMTS.
+ */
+class MtsEspTuningSink final : public TuningSink
+{
+public:
+   /**
+      For benchmarks of the plugin's own core, the training run of a PGO build among them: every core becomes the
+      master without asking libMTS, so each of them does all its tuning work. Without libMTS installed, libMTSMaster
+      drops the calls. Set before activating any core.
+    */
+    static void setBenchmarking(bool benchmarking)
+    {
+        sBenchmarking.store(benchmarking);
+    }
+
+    bool registerMaster(const void* owner) override
+    {
+        if (sBenchmarking.load())
+            return true;
+
+        const void* expected = nullptr;
+        if (!sMasterInstance.compare_exchange_strong(expected, owner))
+            return false;
+
+        if (!MTS_CanRegisterMaster())
+        {
+            sMasterInstance.store(nullptr);
+            return false;
+        }
+
+        MTS_RegisterMaster();
+        return true;
+    }
+
+    void deregisterMaster() override
+    {
+        if (sBenchmarking.load())
+            return;
+
+        MTS_DeregisterMaster();
+        sMasterInstance.store(nullptr);
+    }
+
+    void setNoteTunings(const double freqs[128]) override
+    {
+        MTS_SetNoteTunings(freqs);
+    }
+
+    void setScaleName(const char* name) override
+    {
+        MTS_SetScaleName(name);
+    }
+
+    void filterNote(bool doFilter, char note, char channel) override
+    {
+        MTS_FilterNote(doFilter, note, channel);
+    }
+
+    void clearNoteFilter() override
+    {
+        MTS_ClearNoteFilter();
+    }
+
+    void setMultiChannel(bool set, char channel) override
+    {
+        MTS_SetMultiChannel(set, channel);
+    }
+
+    void setMultiChannelNoteTunings(const double freqs[128], char channel) override
+    {
+        MTS_SetMultiChannelNoteTunings(freqs, channel);
+    }
+
+private:
+    static inline std::atomic<const void*> sMasterInstance { nullptr };
+    static inline std::atomic<bool> sBenchmarking { false };
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+/**
+   Throws everything away but counts the tables, so a benchmark of the core on its own can tell it did the tuning work.
+   Every core publishing to it gets to be the master.
+ */
+class NullTuningSink final : public TuningSink
+{
+public:
+    uint64_t getTables() const { return fTables; }
+
+    bool registerMaster(const void*) override { return true; }
+    void deregisterMaster() override {}
+    void setNoteTunings(const double[128]) override { fTables++; }
+    void setScaleName(const char*) override {}
+    void filterNote(bool, char, char) override {}
+    void clearNoteFilter() override {}
+    void setMultiChannel(bool, char) override {}
+    void setMultiChannelNoteTunings(const double[128], char) override { fTables++; }
+
+private:
+    uint64_t fTables = 0;
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+/**
+   Keeps what an MTS-ESP client would see, and counts the calls, for checking the core's output in tests.
+   Nothing is allocated, so it can be used from run() like the real thing. The master can be taken from any thread;
+   the register and deregister counts are only safe to read while no core using the sink is active.
+ */
+class RecordingTuningSink final : public TuningSink
+{
+public:
+    struct Counts {
+        uint32_t registers;
+        uint32_t deregisters;
+        uint32_t tables;              // setNoteTunings()
+        uint32_t channelTables;       // setMultiChannelNoteTunings()
+        uint32_t scaleNames;
+        uint32_t filterChanges;       // filterNote()
+        uint32_t filterClears;
+        uint32_t multiChannelChanges; // setMultiChannel()
+    };
+
+    RecordingTuningSink()
+    {
+        reset();
+    }
+
+   /**
+      Forget everything, including the counts. There is no master afterwards.
+    */
+    void reset()
+    {
+        std::memset(&fCounts, 0, sizeof(fCounts));
+        std::memset(fTable, 0, sizeof(fTable));
+        std::memset(fChannelTables, 0, sizeof(fChannelTables));
+        std::memset(fFilter, 0, sizeof(fFilter));
+        std::memset(fScaleName, 0, sizeof(fScaleName));
+        fMaster.store(nullptr);
+        fMultiChannel = 0;
+    }
+
+    const Counts& getCounts() const { return fCounts; }
+    bool hasMaster() const { return fMaster.load() != nullptr; }
+    const double* getTable() const { return fTable; }
+    const double* getChannelTable(int32_t channel) const { return fChannelTables[channel]; }
+    const char* getScaleName() const { return fScaleName; }
+
+   /**
+      The table a client on @a channel plays: the channel's own in multi-channel mode, the global one otherwise.
+    */
+    const double* getTableForChannel(int32_t channel) const
+    {
+        return (fMultiChannel & (1u << channel)) != 0 ? fChannelTables[channel] : fTable;
+    }
+
+    bool isMultiChannel(int32_t channel) const
+    {
+        return (fMultiChannel & (1u << channel)) != 0;
+    }
+
+    bool isNoteFiltered(int32_t note, int32_t channel) const
+    {
+        return ((fFilter[channel][note / 64] >> (note % 64)) & 1u) != 0;
+    }
+
+    bool registerMaster(const void* owner) override
+    {
+        const void* expected = nullptr;
+        if (!fMaster.compare_exchange_strong(expected, owner) && expected != owner)
+            return false;
+        fCounts.registers++;
+        return true;
+    }
+
+    void deregisterMaster() override
+    {
+        fMaster.store(nullptr);
+        fCounts.deregisters++;
+    }
+
+    void setNoteTunings(const double freqs[128]) override
+    {
+        std::memcpy(fTable, freqs, sizeof(fTable));
+        fCounts.tables++;
+    }
+
+    void setScaleName(const char* name) override
+    {
+        std::snprintf(fScaleName, sizeof(fScaleName), "%s", name);
+        fCounts.scaleNames++;
+    }
+
+    void filterNote(bool doFilter, char note, char channel) override
+    {
+        const uint64_t bit = uint64_t(1) << (note % 64);
+        for (int32_t ch = 0; ch < 16; ch++)
+        {
+            if (channel >= 0 && ch != channel)
+                continue;
+            if (doFilter)
+                fFilter[ch][note / 64] |= bit;
+            else
+                fFilter[ch][note / 64] &= ~bit;
+        }
+        fCounts.filterChanges++;
+    }
+
+    void clearNoteFilter() override
+    {
+        std::memset(fFilter, 0, sizeof(fFilter));
+        fCounts.filterClears++;
+    }
+
+    void setMultiChannel(bool set, char channel) override
+    {
+        if (set)
+            fMultiChannel |= 1u << channel;
+        else
+            fMultiChannel &= ~(1u << channel);
+        fCounts.multiChannelChanges++;
+    }
+
+    void setMultiChannelNoteTunings(const double freqs[128], char channel) override
+    {
+        std::memcpy(fChannelTables[static_cast<uint8_t>(channel)], freqs, sizeof(fChannelTables[0]));
+        fCounts.channelTables++;
+    }
+
+private:
+    Counts fCounts;
+    std::atomic<const void*> fMaster;
+    uint32_t fMultiChannel; // bitmask of channels with a table of their own
+    double fTable[128];
+    double fChannelTables[16][128];
+    uint64_t fFilter[16][2];
+    char fScaleName[64];
+};
+
+#endif
@@ -14,40 +14,82 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
 #include <string>
+#include <vector>
 #include "DistrhoUI.hpp"
 #include "ResizeHandle.hpp"
 #include "extra/String.hpp"
 #include "ScaleSequencePlusControls.hpp"
+#include "ScaleSequencePlusLibrary.hpp"
+#include "ScaleSequencePlusShared.hpp"
+#include "ScaleSequencePlusStepGrid.hpp"
 #include "BrunoAceFont.hpp"
 #include "BrunoAceSCFont.hpp"
 #include "LektonRegularFont.hpp"
-#include "Tunings.h"
 
 START_NAMESPACE_DISTRHO
 
-const char* kStateKeys[kStateCount] = {
-    "scl_file_1",
-    "scl_file_2",
-    "scl_file_3",
-    "scl_file_4",
-    "scl_file_5",
-    "scl_file_6",
-    "scl_file_7",
-    "scl_file_8",
-    "kbm_file_1",
-    "kbm_file_2",
-    "kbm_file_3",
-    "kbm_file_4",
-    "kbm_file_5",
-    "kbm_file_6",
-    "kbm_file_7",
-    "kbm_file_8",
+// Button labels, indexed by parameter value. The step labels are in ScaleSequencePlusStepGrid.hpp.
+static const char* const kChannelLabels[13] = { "S", "1", "2", "3", "4", "5", "6", "7", "8", "L1", "L2", "L3", "L4" };
+static const char* const kLaneLabels[kNumLanes] = { "1", "2", "3", "4" };
+
+// --------------------------------------------------------------------------------------------------------------------
+
+/**
+   Font atlas shared by all editors in the process that use the same scale factor.
+   The embedded fonts are decoded and rasterized only when the first editor at that scale opens;
+   after that, opening an editor just uploads the cached atlas texture.
+ */
+struct SharedFonts
+{
+    double scale_factor;
+    ImFontAtlas* atlas;
+    ImFont* brunoAceFont;
+    ImFont* brunoAceStepFont;
+    ImFont* brunoAceSCFont;
+    ImFont* lektonRegularFont;
+
+    explicit SharedFonts(double scale)
+        : scale_factor(scale),
+          atlas(new ImFontAtlas())
+    {
+        brunoAceFont = AddBrunoAceFont(atlas, scale);
+        lektonRegularFont = AddLektonRegularFont(atlas, scale);
+        brunoAceStepFont = AddBrunoAceFont(atlas, scale*1.3);
+        brunoAceSCFont = AddBrunoAceSCFont(atlas, scale);
+        atlas->Build();
+    }
+
+    ~SharedFonts()
+    {
+        delete atlas;
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(SharedFonts)
 };
 
+static const SharedFonts& getSharedFonts(double scale_factor)
+{
+    // Atlases live until the plugin binary is unloaded
+    static std::vector<std::unique_ptr<SharedFonts>> sharedFonts;
+
+    for (const std::unique_ptr<SharedFonts>& fonts : sharedFonts)
+    {
+        if (fonts->scale_factor == scale_factor)
+            return *fonts;
+    }
+
+    sharedFonts.emplace_back(new SharedFonts(scale_factor));
+    return *sharedFonts.back();
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 
-class ScaleSequencePlusUI : public UI
+class ScaleSequencePlusUI : public UI,
+                            private StepGridEditor
 {
 public:
    /**
@@ -78,17 +120,43 @@ public:
 			fFileBaseName[i] = d;
 		}
 		
- 		utuning1 = Tunings::Tuning(); 
-		utuning2 = Tunings::Tuning(); 
-		utuning3 = Tunings::Tuning(); 
-		utuning4 = Tunings::Tuning(); 
-		utuning5 = Tunings::Tuning(); 
-		utuning6 = Tunings::Tuning(); 
-		utuning7 = Tunings::Tuning(); 
-		utuning8 = Tunings::Tuning(); 
+		// The file names shown come from the plugin, which has already parsed the files
+		std::memset(fTuningFileInfo, 0, sizeof(fTuningFileInfo));
+		fTuningFileInfoVersion = 0;
+		fShared = ScaleSequencePlusShared::fromInstancePointer(getPluginInstancePointer());
 		
+		ui_lane = 0;
+		ui_lanes = static_cast<int>(ParameterDefaults[kParameterLanes]);
 		ui_multiplier = static_cast<int>(ParameterDefaults[kParameterMultiplier]);
 		ui_loopPoint = static_cast<int>(ParameterDefaults[kParameterLoopPoint]);
+		ui_multiChannel = ParameterDefaults[kParameterMultiChannel] > 0.5f;
+		ui_sysexDinRate = ParameterDefaults[kParameterSysExDinRate] > 0.5f;
+		ui_mpeOutput = ParameterDefaults[kParameterMpeOutput] > 0.5f;
+		ui_mpeBendRange = static_cast<int>(ParameterDefaults[kParameterMpeBendRange]);
+		ui_showTuningView = false;
+		
+		std::memset(&fTuningSnapshot, 0, sizeof(fTuningSnapshot));
+		fTuningSnapshotSeen = 0;
+		std::memset(fCurrentCents, 0, sizeof(fCurrentCents));
+		std::memset(fTargetCents, 0, sizeof(fTargetCents));
+		fCentsRange = 50.0f;
+		fGlideProgress = 1.0f;
+		
+		ui_showPerfStats = false;
+		std::memset(&fPerfStatsSnapshot, 0, sizeof(fPerfStatsSnapshot));
+		std::memset(fPerfHistogram, 0, sizeof(fPerfHistogram));
+		fPerfHistogramStart = 0;
+		fPerfHistogramCount = 0;
+		fPerfStatsIdleCount = 0;
+		
+		ui_showLibrary = false;
+		ui_libraryRoots[0] = '\0';
+		ui_librarySearch[0] = '\0';
+		ui_librarySlot = 1;
+		fLibraryIndexPath = getScaleLibraryIndexPath();
+		fLibrarySelected = -1;
+		fLibraryIdleCount = 0;
+		openLibrary();
 		
         // account for scaling
         scale_factor = getScaleFactor();
@@ -96,18 +164,38 @@ public:
         
         UI_COLUMN_WIDTH = 312 * scale_factor;
         
-        // Setup fonts
+        // Setup fonts, using the atlas shared by all editors at this scale factor.
+        // The context's own atlas is put back in the destructor, before the context is destroyed.
         ImGuiIO& io = ImGui::GetIO();
-        io.Fonts->Clear();
+        const SharedFonts& fonts(getSharedFonts(scale_factor));
+        
+        fImGuiIO = &io;
+        fOwnFontAtlas = io.Fonts;
+        fFontTexture = nullptr;
+        io.Fonts = fonts.atlas;
         
-        brunoAceFont = AddBrunoAceFont(scale_factor);
-        lektonRegularFont = AddLektonRegularFont(scale_factor);
-        brunoAceStepFont = AddBrunoAceFont(scale_factor*1.3);
-        brunoAceSCFont = AddBrunoAceSCFont(scale_factor);
+        brunoAceFont = fonts.brunoAceFont;
+        lektonRegularFont = fonts.lektonRegularFont;
+        brunoAceStepFont = fonts.brunoAceStepFont;
+        brunoAceSCFont = fonts.brunoAceSCFont;
         
         show_error_popup = false;
         errorText.clear();
         
+        fRepaintPending = false;
+        
+        if (fShared != nullptr)
+        {
+            fTuningFileInfoVersion = fShared->getTuningFileInfoVersion() - 1;
+            syncTuningFileInfo();
+        }
+        else
+        {
+            // Standard tunings until the host sends the states
+            for (int32_t i = 0; i < kStateCount; i++)
+                inspectTuningFile(static_cast<States>(i), "");
+        }
+        
         // Set style and colours
         ImGuiStyle& uistyle = ImGui::GetStyle();
         
@@ -182,6 +270,11 @@ public:
         uistyle.Colors[ImGuiCol_ModalWindowDimBg] =  black;
     }
 
+    ~ScaleSequencePlusUI() override
+    {
+        fImGuiIO->Fonts = fOwnFontAtlas;
+    }
+
 protected:
     // ----------------------------------------------------------------------------------------------------------------
     // DSP/Plugin Callbacks
@@ -192,24 +285,43 @@ protected:
     */
     void parameterChanged(uint32_t index, float value) override
     {
+        // Hosts resend values that haven't changed, the current step output in particular
+        if (fParameters[index] == value)
+            return;
+        
         fParameters[index] = value;
         
+        // Step Multi and Loop Point show the lane being edited
+        if (index == laneParameter(ui_lane, kLaneMultiplier))
+            ui_multiplier = static_cast<int>(value);
+        else if (index == laneParameter(ui_lane, kLaneLoopPoint))
+            ui_loopPoint = static_cast<int>(value);
+        
         // update ui variables for SliderInt and CheckBox widgets
         // Check for File load success
         switch (index)
         {
-        case kParameterMultiplier:
-            ui_multiplier = static_cast<int>(fParameters[kParameterMultiplier]);
+        case kParameterLanes:
+            ui_lanes = static_cast<int>(fParameters[kParameterLanes]);
             break;
-        case kParameterLoopPoint:
-            ui_loopPoint = static_cast<int>(fParameters[kParameterLoopPoint]);
+        case kParameterMultiChannel:
+            ui_multiChannel = fParameters[kParameterMultiChannel] > 0.5f;
+            break;
+        case kParameterSysExDinRate:
+            ui_sysexDinRate = fParameters[kParameterSysExDinRate] > 0.5f;
+            break;
+        case kParameterMpeOutput:
+            ui_mpeOutput = fParameters[kParameterMpeOutput] > 0.5f;
+            break;
+        case kParameterMpeBendRange:
+            ui_mpeBendRange = static_cast<int>(fParameters[kParameterMpeBendRange]);
             break;
 		
         default:
             break;
         }
         
-        repaint();
+        fRepaintPending = true;
     }
 
    /**
@@ -218,219 +330,190 @@ protected:
     */
     void stateChanged(const char* key, const char* value) override
     {
-		States stateId = kStateCount;
-
-        /**/ if (std::strcmp(key, "scl_file_1") == 0)
-            stateId = kStateFileSCL1;
-        else if (std::strcmp(key, "scl_file_2") == 0)
-            stateId = kStateFileSCL2;
-        else if (std::strcmp(key, "scl_file_3") == 0)
-            stateId = kStateFileSCL3;
-        else if (std::strcmp(key, "scl_file_4") == 0)
-            stateId = kStateFileSCL4;
-        else if (std::strcmp(key, "scl_file_5") == 0)
-            stateId = kStateFileSCL5;
-        else if (std::strcmp(key, "scl_file_6") == 0)
-            stateId = kStateFileSCL6;
-        else if (std::strcmp(key, "scl_file_7") == 0)
-            stateId = kStateFileSCL7;
-        else if (std::strcmp(key, "scl_file_8") == 0)
-            stateId = kStateFileSCL8;
-        else if (std::strcmp(key, "kbm_file_1") == 0)
-            stateId = kStateFileKBM1;
-        else if (std::strcmp(key, "kbm_file_2") == 0)
-            stateId = kStateFileKBM2;
-        else if (std::strcmp(key, "kbm_file_3") == 0)
-            stateId = kStateFileKBM3;
-        else if (std::strcmp(key, "kbm_file_4") == 0)
-            stateId = kStateFileKBM4;
-        else if (std::strcmp(key, "kbm_file_5") == 0)
-            stateId = kStateFileKBM5;
-        else if (std::strcmp(key, "kbm_file_6") == 0)
-            stateId = kStateFileKBM6;
-        else if (std::strcmp(key, "kbm_file_7") == 0)
-            stateId = kStateFileKBM7;
-        else if (std::strcmp(key, "kbm_file_8") == 0)
-            stateId = kStateFileKBM8;
+		const States stateId = stateForKey(key);
 
         if (stateId == kStateCount)
             return;
         
+        tuningFileChanged(stateId, value);
+    }
+    
+   /**
+      The file of state @a stateId is now @a value, sent by the host or set by the UI itself.
+      The plugin parses the file and reports the result, which is picked up here if it already has, or in uiIdle().
+      Without access to the plugin, e.g. with the UI in a process of its own, the UI reads the file itself.
+    */
+    void tuningFileChanged(States stateId, const char* value)
+    {
         fState[stateId] = value;
         
-        // NOTE: We will mirror what's happening on the DSP side
-
-        if (stateId == 0)
-		{	
-			checkScl(utuning1, value, stateId);
-		}
-		else if (stateId == 1)
-		{
-			checkScl(utuning2, value, stateId);
-		}
-		else if (stateId == 2)
-		{
-			checkScl(utuning3, value, stateId);
-		}	
-		else if (stateId == 3)
-		{	
-			checkScl(utuning4, value, stateId);
-		}
-		else if (stateId == 4)
-		{	
-			checkScl(utuning5, value, stateId);
-		}
-		else if (stateId == 5)
-		{
-			checkScl(utuning6, value, stateId);
-		}
-		else if (stateId == 6)
-		{
-			checkScl(utuning7, value, stateId);
-		}	
-		else if (stateId == 7)
-		{	
-			checkScl(utuning8, value, stateId);
-		}				
-		else if (stateId == 8)
-		{
-			checkKbm(utuning1, value, stateId);
-		}
-		else if (stateId == 9)
-		{
-			checkKbm(utuning2, value, stateId);
-		}
-		else if (stateId == 10)
-		{
-			checkKbm(utuning3, value, stateId);
-		}
-		else if (stateId == 11)
-		{
-			checkKbm(utuning4, value, stateId);
-		}
-	    else if (stateId == 12)
-		{
-			checkKbm(utuning5, value, stateId);
-		}
-		else if (stateId == 13)
-		{
-			checkKbm(utuning6, value, stateId);
-		}
-		else if (stateId == 14)
-		{
-			checkKbm(utuning7, value, stateId);
-		}
-		else if (stateId == 15)
-		{
-			checkKbm(utuning8, value, stateId);
-		}
-	
-        repaint();
+        if (fShared != nullptr)
+            syncTuningFileInfo();
+        else
+            inspectTuningFile(stateId, value);
+        
+        fRepaintPending = true;
     }
     
-	void checkScl(Tunings::Tuning & tn, const char* value, const States & stateId)
+   /**
+      Fetch the tuning file info from the plugin if it changed since the last call.
+    */
+    void syncTuningFileInfo()
     {
-		String filename(value);
-		auto k = tn.keyboardMapping;
-		
-		if (filename.endsWith(".scl"))
-		{
-			try
-			{   auto s = Tunings::readSCLFile(value);
-				tn = Tunings::Tuning(s, k);
-                const char *a = tn.scale.name.c_str();
-                fFileBaseName[stateId] = getFileBaseName(a);
-			}
-			catch (const std::exception& e)
-			{
-				tn = Tunings::Tuning();
-				String noScl("Standard SCL tuning");
-                String noKbm("Standard KBM mapping");
-                fFileBaseName[stateId] = noScl;
-                fFileBaseName[stateId+8] = noKbm;
-                String tuningError(e.what());
-                errorText = "Tuning error:\n" + tuningError + "\nScale reset to standard tuning and mapping.";
-                setState(kStateKeys[stateId], "");
-				setState(kStateKeys[stateId+8], "");
-                show_error_popup = true;
-                //d_stdout("UI:");
-                //d_stdout(e.what());
-			}
-		}
-		else
-		{
-			auto s = Tunings::Tuning().scale;
-			tn = Tunings::Tuning(s, k);
-			String noScl("Standard SCL tuning");
-			fFileBaseName[stateId] = noScl;
-			
-			if (filename.isNotEmpty())
-			{
-				errorText = "Not a .scl file.\nSCL tuning reset to standard.";
-				show_error_popup = true;
-				setState(kStateKeys[stateId], "");
-			}
-		}
-	}
-	
-	void checkKbm(Tunings::Tuning & tn, const char* value, const States & stateId)
-	{
-		String filename(value);
-		auto s = tn.scale;
-		if (filename.endsWith(".kbm"))
-		{
-			try
-			{
-				auto k = Tunings::readKBMFile(value);
-				tn = Tunings::Tuning(s, k);
-				const char *a = tn.keyboardMapping.name.c_str();
-                fFileBaseName[stateId] = getFileBaseName(a);
-			}
-			catch (const std::exception& e)
-			{
-				tn = Tunings::Tuning();
-				String noScl("Standard SCL tuning");
-                String noKbm("Standard KBM mapping");
-                fFileBaseName[stateId - 8] = noScl;
-                fFileBaseName[stateId] = noKbm;
-                String tuningError(e.what());
-                errorText = "Tuning error:\n" + tuningError + "\nScale reset to standard tuning and mapping.";
-                setState(kStateKeys[stateId], "");
-				setState(kStateKeys[stateId-8], "");
-                show_error_popup = true;
-                //d_stdout("UI:");
-                //d_stdout(e.what());
-			}
-		}
-		else
-		{
-			auto k = Tunings::Tuning().keyboardMapping;
-			tn = Tunings::Tuning(s, k);
-			String noKbm("Standard KBM mapping");
-			fFileBaseName[stateId] = noKbm;
-			
-			if (filename.isNotEmpty())
-			{
-				errorText = "Not a .kbm file.\nKBM mapping reset to standard.";
-				show_error_popup = true;
-				setState(kStateKeys[stateId], "");
-			}
-		}
-	}
-	
-    String getFileBaseName(const char* value)
+        if (fShared == nullptr || fShared->getTuningFileInfoVersion() == fTuningFileInfoVersion)
+            return;
+        
+        TuningFileInfo info[kStateCount];
+        fTuningFileInfoVersion = fShared->copyTuningFileInfo(info);
+        
+        for (int32_t i = 0; i < kStateCount; i++)
+        {
+            if (std::memcmp(&info[i], &fTuningFileInfo[i], sizeof(TuningFileInfo)) == 0)
+                continue;
+            
+            showTuningFileInfo(static_cast<States>(i), info[i]);
+        }
+    }
+    
+   /**
+      Without access to the plugin: read the file of state @a stateId the way the plugin does, and show what it
+      found. If the file resets the whole slot, the other file of the pair is shown as reset too.
+    */
+    void inspectTuningFile(States stateId, const char* path)
+    {
+        const TuningFileInfo info(ScaleSequencePlusCore::inspectTuningFile(stateId, path));
+        
+        if (info.pairReset)
+        {
+            const States pairId = pairState(stateId);
+            showTuningFileInfo(pairId, ScaleSequencePlusCore::inspectTuningFile(pairId, ""));
+        }
+        
+        showTuningFileInfo(stateId, info);
+    }
+    
+   /**
+      Show the tuning file info of state @a stateId.
+      A file the plugin rejected is reported to the user and its state cleared, as the plugin has reset that tuning.
+    */
+    void showTuningFileInfo(States stateId, const TuningFileInfo& info)
+    {
+        fTuningFileInfo[stateId] = info;
+        fFileBaseName[stateId] = info.name;
+        
+        if (! info.valid)
+        {
+            errorText = info.error;
+            show_error_popup = true;
+            setState(kStateDescriptors[stateId].key, "");
+            if (info.pairReset)
+                setState(kStateDescriptors[pairState(stateId)].key, "");
+        }
+        
+        fRepaintPending = true;
+    }
+    
+   /**
+      The other file of the slot of state @a stateId: its .kbm for an .scl, and its .scl for a .kbm.
+    */
+    static States pairState(States stateId)
+    {
+        return static_cast<States>(stateId < kStateFileKBM1 ? stateId + kStateFileKBM1 : stateId - kStateFileKBM1);
+    }
+    
+   /**
+      Idle callback, called periodically by the host.
+      Changes from the plugin side only mark the UI as needing a repaint, so a burst of them results in a single
+      frame here. Nothing is drawn while the window is hidden; the repaint stays pending until it is shown again.
+    */
+    void uiIdle() override
+    {
+        syncTuningFileInfo();
+        
+        // At most one snapshot per frame: a new one is only asked for once the last request has been seen here
+        if (ui_showTuningView && fShared != nullptr && isVisible())
+        {
+            if (fShared->readTuningSnapshot(fTuningSnapshot, fTuningSnapshotSeen))
+            {
+                updateTuningView();
+                fRepaintPending = true;
+            }
+            fShared->requestTuningSnapshot();
+        }
+        
+        // Show the scan progress, and the new index once it is written
+        if (ui_showLibrary && fLibraryScanner.isRunning() && isVisible() && ++fLibraryIdleCount >= 10)
+        {
+            fLibraryIdleCount = 0;
+            fRepaintPending = true;
+        }
+        if (fLibraryScanner.takeFinished())
+        {
+            openLibrary();
+            fRepaintPending = true;
+        }
+        
+        // The statistics change with every block, so refresh them a few times per second at most
+        if (ui_showPerfStats && fShared != nullptr && isVisible() && ++fPerfStatsIdleCount >= 10)
+        {
+            fPerfStatsIdleCount = 0;
+            updatePerfStats();
+            fRepaintPending = true;
+        }
+        
+        if (fRepaintPending && isVisible())
+        {
+            fRepaintPending = false;
+            repaint();
+        }
+    }
+    
+   /**
+      Show what the plugin found in the file when the previous item is hovered.
+    */
+    void tuningFileTooltip(States stateId)
+    {
+        if (! ImGui::IsItemHovered())
+            return;
+        
+        const TuningFileInfo& info(fTuningFileInfo[stateId]);
+        
+        if (stateId < kStateFileKBM1)
+            ImGui::SetTooltip("%d notes, period %.3f cents", info.noteCount, info.period);
+        else
+            ImGui::SetTooltip("%d keys, octave %d degrees", info.noteCount, static_cast<int>(info.period));
+    }
+    
+   /**
+      Show lane @a lane in the sequence pane, with its Step Multi and Loop Point.
+    */
+    void selectLane(int32_t lane)
     {
-        std::string p(value);
-        // TODO Find a better way to derive the file name!
-        p = p.substr(p.find_last_of("/\\") +1);
-        const char *a = p.c_str();
-        String baseName(a);
-        return baseName;
+        ui_lane = lane;
+        ui_multiplier = static_cast<int>(fParameters[laneParameter(lane, kLaneMultiplier)]);
+        ui_loopPoint = static_cast<int>(fParameters[laneParameter(lane, kLaneLoopPoint)]);
     }
     
     // ----------------------------------------------------------------------------------------------------------------
     // Widget Callbacks
 
+   /**
+      Every editor uploads the shared font atlas to a texture in its own GL context, and the atlas only remembers
+      the last one. The backend uploads it in the first frame; from then on the atlas is pointed at this editor's
+      texture before ImGui starts the frame, so that whatever the backend reads while drawing it is ours.
+    */
+    void onDisplay() override
+    {
+        ImFontAtlas* const atlas = fImGuiIO->Fonts;
+        if (fFontTexture != nullptr)
+            atlas->SetTexID(fFontTexture);
+        
+        UI::onDisplay();
+        
+        if (fFontTexture == nullptr)
+            fFontTexture = atlas->TexID;
+    }
+    
    /**
       ImGui specific onDisplay function.
     */
@@ -457,6 +540,31 @@ protected:
             //ImGui::PopStyleColor();
             ImGui::PopFont();
             
+            // MTS-ESP master status
+            ImGui::PushFont(lektonRegularFont);
+            if (fParameters[kParameterMasterStatus] > 0.5f)
+                ImGui::Text("MTS-ESP master");
+            else if (fParameters[kParameterBypass] > 0.5f)
+                ImGui::Text("Bypassed");
+            else
+                ImGui::Text("Inactive: another MTS-ESP master is registered");
+            
+            ImGui::SameLine(width - 2 * margin - UI_COLUMN_WIDTH * 3 / 2);
+            ImGui::Checkbox("Scale Library", &ui_showLibrary);
+            
+            if (fShared != nullptr)
+            {
+                if (PerfStats::kEnabled)
+                {
+                    ImGui::SameLine(width - 2 * margin - UI_COLUMN_WIDTH);
+                    ImGui::Checkbox("DSP Load", &ui_showPerfStats);
+                }
+                
+                ImGui::SameLine(width - 2 * margin - UI_COLUMN_WIDTH / 2);
+                ImGui::Checkbox("Tuning View", &ui_showTuningView);
+            }
+            ImGui::PopFont();
+            
             ImGui::EndChild(); // title pane
             
             ImGui::BeginChild("top pane", ImVec2(0, 300 * scale_factor)); // top pane holds four colums
@@ -471,20 +579,22 @@ protected:
             
 			if (ImGui::Button("Open SCL File##1"))
 			{
-				requestStateFile(kStateKeys[kStateFileSCL1]);
+				requestStateFile(kStateDescriptors[kStateFileSCL1].key);
 			}
 			
 			ImGui::SameLine(); 
 			
 			if (ImGui::Button("Open KBM File##1"))
 			{
-				requestStateFile(kStateKeys[kStateFileKBM1]);
+				requestStateFile(kStateDescriptors[kStateFileKBM1].key);
 			}
 			
 			ImGui::PushFont(lektonRegularFont);
 			ImGui::PushItemWidth(-1);
 			ImGui::LabelText("##scale_1_scl", fFileBaseName[kStateFileSCL1]);
+			tuningFileTooltip(kStateFileSCL1);
 			ImGui::LabelText("##scale_1_kbm", fFileBaseName[kStateFileKBM1]);
+			tuningFileTooltip(kStateFileKBM1);
 			ImGui::PopItemWidth();
 			ImGui::PopFont();
             
@@ -499,20 +609,22 @@ protected:
             
 			if (ImGui::Button("Open SCL File##5"))
 			{
-				requestStateFile(kStateKeys[kStateFileSCL5]);
+				requestStateFile(kStateDescriptors[kStateFileSCL5].key);
 			}
 			
 			ImGui::SameLine(); 
 			
 			if (ImGui::Button("Open KBM File##5"))
 			{
-				requestStateFile(kStateKeys[kStateFileKBM5]);
+				requestStateFile(kStateDescriptors[kStateFileKBM5].key);
 			}
 			
 			ImGui::PushFont(lektonRegularFont);
 			ImGui::PushItemWidth(-1);
 			ImGui::LabelText("##scale_5_scl", fFileBaseName[kStateFileSCL5]);
+			tuningFileTooltip(kStateFileSCL5);
 			ImGui::LabelText("##scale_5_kbm", fFileBaseName[kStateFileKBM5]);
+			tuningFileTooltip(kStateFileKBM5);
             ImGui::PopItemWidth();
             ImGui::PopFont();
             
@@ -535,20 +647,22 @@ protected:
             
 			if (ImGui::Button("Open SCL File##2"))
 			{
-				requestStateFile(kStateKeys[kStateFileSCL2]);
+				requestStateFile(kStateDescriptors[kStateFileSCL2].key);
 			}
 			
 			ImGui::SameLine(); 
 			
 			if (ImGui::Button("Open KBM File##2"))
 			{
-				requestStateFile(kStateKeys[kStateFileKBM2]);
+				requestStateFile(kStateDescriptors[kStateFileKBM2].key);
 			}
 			
 			ImGui::PushFont(lektonRegularFont);
 			ImGui::PushItemWidth(-1);
 			ImGui::LabelText("##scale_2_scl", fFileBaseName[kStateFileSCL2]);
+			tuningFileTooltip(kStateFileSCL2);
 			ImGui::LabelText("##scale_2_kbm", fFileBaseName[kStateFileKBM2]);
+			tuningFileTooltip(kStateFileKBM2);
             ImGui::PopItemWidth();
             ImGui::PopFont();
             
@@ -562,20 +676,22 @@ protected:
             
 			if (ImGui::Button("Open SCL File##6"))
 			{
-				requestStateFile(kStateKeys[kStateFileSCL6]);
+				requestStateFile(kStateDescriptors[kStateFileSCL6].key);
 			}
 			
 			ImGui::SameLine(); 
 			
 			if (ImGui::Button("Open KBM File##6"))
 			{
-				requestStateFile(kStateKeys[kStateFileKBM6]);
+				requestStateFile(kStateDescriptors[kStateFileKBM6].key);
 			}
 			
 			ImGui::PushFont(lektonRegularFont);
 			ImGui::PushItemWidth(-1);
 			ImGui::LabelText("##scale_6_scl", fFileBaseName[kStateFileSCL6]);
+			tuningFileTooltip(kStateFileSCL6);
 			ImGui::LabelText("##scale_6_kbm", fFileBaseName[kStateFileKBM6]);
+			tuningFileTooltip(kStateFileKBM6);
             ImGui::PopItemWidth();
             ImGui::PopFont();
             
@@ -596,20 +712,22 @@ protected:
             
 			if (ImGui::Button("Open SCL File##3"))
 			{
-				requestStateFile(kStateKeys[kStateFileSCL3]);
+				requestStateFile(kStateDescriptors[kStateFileSCL3].key);
 			}
 			
 			ImGui::SameLine(); 
 			
 			if (ImGui::Button("Open KBM File##3"))
 			{
-				requestStateFile(kStateKeys[kStateFileKBM3]);
+				requestStateFile(kStateDescriptors[kStateFileKBM3].key);
 			}
 			
 			ImGui::PushFont(lektonRegularFont);
 			ImGui::PushItemWidth(-1);
 			ImGui::LabelText("##scale_3_scl", fFileBaseName[kStateFileSCL3]);
+			tuningFileTooltip(kStateFileSCL3);
 			ImGui::LabelText("##scale_3_kbm", fFileBaseName[kStateFileKBM3]);
+			tuningFileTooltip(kStateFileKBM3);
             ImGui::PopItemWidth();
             ImGui::PopFont();
             
@@ -623,20 +741,22 @@ protected:
             
 			if (ImGui::Button("Open SCL File##7"))
 			{
-				requestStateFile(kStateKeys[kStateFileSCL7]);
+				requestStateFile(kStateDescriptors[kStateFileSCL7].key);
 			}
 			
 			ImGui::SameLine(); 
 			
 			if (ImGui::Button("Open KBM File##7"))
 			{
-				requestStateFile(kStateKeys[kStateFileKBM7]);
+				requestStateFile(kStateDescriptors[kStateFileKBM7].key);
 			}
 			
 			ImGui::PushFont(lektonRegularFont);
 			ImGui::PushItemWidth(-1);
 			ImGui::LabelText("##scale_7_scl", fFileBaseName[kStateFileSCL7]);
+			tuningFileTooltip(kStateFileSCL7);
 			ImGui::LabelText("##scale_7_kbm", fFileBaseName[kStateFileKBM7]);
+			tuningFileTooltip(kStateFileKBM7);
             ImGui::PopItemWidth();
             ImGui::PopFont();
             
@@ -657,20 +777,22 @@ protected:
             
 			if (ImGui::Button("Open SCL File##4"))
 			{
-				requestStateFile(kStateKeys[kStateFileSCL4]);
+				requestStateFile(kStateDescriptors[kStateFileSCL4].key);
 			}
 			
 			ImGui::SameLine(); 
 			
 			if (ImGui::Button("Open KBM File##4"))
 			{
-				requestStateFile(kStateKeys[kStateFileKBM4]);
+				requestStateFile(kStateDescriptors[kStateFileKBM4].key);
 			}
 			
 			ImGui::PushFont(lektonRegularFont);
 			ImGui::PushItemWidth(-1);
 			ImGui::LabelText("##scale_4_scl", fFileBaseName[kStateFileSCL4]);
+			tuningFileTooltip(kStateFileSCL4);
 			ImGui::LabelText("##scale_4_kbm", fFileBaseName[kStateFileKBM4]);
+			tuningFileTooltip(kStateFileKBM4);
             ImGui::PopItemWidth();
             ImGui::PopFont();
             
@@ -684,20 +806,22 @@ protected:
             
 			if (ImGui::Button("Open SCL File##8"))
 			{
-				requestStateFile(kStateKeys[kStateFileSCL8]);
+				requestStateFile(kStateDescriptors[kStateFileSCL8].key);
 			}
 			
 			ImGui::SameLine(); 
 			
 			if (ImGui::Button("Open KBM File##8"))
 			{
-				requestStateFile(kStateKeys[kStateFileKBM8]);
+				requestStateFile(kStateDescriptors[kStateFileKBM8].key);
 			}
 			
 			ImGui::PushFont(lektonRegularFont);
 			ImGui::PushItemWidth(-1);
 			ImGui::LabelText("##scale_8_scl", fFileBaseName[kStateFileSCL8]);
+			tuningFileTooltip(kStateFileSCL8);
 			ImGui::LabelText("##scale_8_kbm", fFileBaseName[kStateFileKBM8]);
+			tuningFileTooltip(kStateFileKBM8);
             ImGui::PopItemWidth();
             ImGui::PopFont();
             
@@ -713,1169 +837,135 @@ protected:
             
             ImGui::LabelText("##sequence_label", "SEQUENCE");
             
+            // Which lane the steps, Step Multi and Loop Point below are for. Lanes that are not playing are dimmed.
+            ImGui::SameLine();
+            ImGui::Text("Lane");
+            for (int32_t lane = 0; lane < kNumLanes; lane++)
+            {
+                ImGui::SameLine();
+                ImGui::PushID(kNumSteps + lane);
+                
+                const bool selected = lane == ui_lane;
+                if (selected)
+                    ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
+                if (lane >= ui_lanes)
+                    ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
+                
+                if (ImGui::SmallButton(kLaneLabels[lane]))
+                    selectLane(lane);
+                
+                if (lane >= ui_lanes)
+                    ImGui::PopStyleVar();
+                if (selected)
+                    ImGui::PopStyleColor();
+                
+                ImGui::PopID();
+            }
+            
             ImGui::PushFont(brunoAceStepFont);
             
-            const std::string scale_choice[9] = { "0", "1", "2", "3", "4", "5", "6", "7", "8"};
             ImVec2 step_button_sz(32 * scale_factor,32 * scale_factor);
             
-            // Step 1
-            std::string step_1_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep1])];
-            step_1_text.append("##step_1");
-            const char* step_1_lbl = step_1_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.03125f)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-            
-			if (ImGui::Button(step_1_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep1, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep1]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep1] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep1, fParameters[kParameterStep1]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.03125f)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep1, false);
-            }
-			
-			ImGui::SameLine(); 
+            drawStepGrid(fParameters, ui_lane, step_button_sz, step_highlight_color, *this);
 			
-			// Step 2
-            std::string step_2_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep2])];
-            step_2_text.append("##step_2");
-            const char* step_2_lbl = step_2_text.c_str();
-           
-            if (fParameters[kParameterCurrentStep] == 0.0625f)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-            
-			if (ImGui::Button(step_2_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep2, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep2]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep2] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep2, fParameters[kParameterStep2]);
-			}
+			ImGui::PopFont();
 			
-			if (fParameters[kParameterCurrentStep] == 0.0625f)
-            {
-				ImGui::PopStyleColor();
-			}
+			ImGui::EndChild(); // sequence pane
 			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep2, false);
-            }
+			//----------------------------------
 			
-			ImGui::SameLine(); 
+			ImGui::BeginChild("channels pane", ImVec2(0, 70 * scale_factor));
 			
-			// Step 3
-            std::string step_3_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep3])];
-            step_3_text.append("##step_3");
-            const char* step_3_lbl = step_3_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.09375f)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
+			ImGui::LabelText("##channels_label", "CHANNELS");
 			
-			if (ImGui::Button(step_3_lbl, step_button_sz))
+			// Multi-Channel
+			if (ImGui::Checkbox("Multi-Channel", &ui_multiChannel))
 			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep3, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep3]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep3] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep3, fParameters[kParameterStep3]);
+				editParameter(kParameterMultiChannel, true);
+				fParameters[kParameterMultiChannel] = ui_multiChannel ? 1.0f : 0.0f;
+				setParameterValue(kParameterMultiChannel, fParameters[kParameterMultiChannel]);
+				editParameter(kParameterMultiChannel, false);
 			}
 			
-			if (fParameters[kParameterCurrentStep] == 0.09375f)
-            {
-				ImGui::PopStyleColor();
-			}
+			// Channel buttons. "S" follows the sequence, 1 to 8 pins the channel to that scale, L1 to L4 follow one lane.
+			ImVec2 channel_button_sz(28 * scale_factor, 28 * scale_factor);
 			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep3, false);
-            }
+			if (!ui_multiChannel)
+				ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
 			
-			ImGui::SameLine(); 
+			for (int32_t ch = 0; ch < kNumChannels; ch++)
+			{
+				const uint32_t index = kParameterChannel1 + ch;
+				
+				ImGui::SameLine();
+				ImGui::PushID(ch);
+				
+				if (ImGui::Button(kChannelLabels[static_cast<uint32_t>(fParameters[index])], channel_button_sz))
+				{
+					if (ImGui::IsItemActivated())
+						editParameter(index, true);
+					
+					uint32_t cur_val = static_cast<uint32_t>(fParameters[index]);
+					cur_val += 1;
+					if (cur_val > 8 + kNumLanes)
+						cur_val = 0;
+					fParameters[index] = static_cast<float>(cur_val);
+					setParameterValue(index, fParameters[index]);
+				}
+				
+				if (ImGui::IsItemDeactivated())
+				{
+					editParameter(index, false);
+				}
+				
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("MIDI channel %d", ch + 1);
+				
+				ImGui::PopID();
+			}
+			
+			if (!ui_multiChannel)
+				ImGui::PopStyleVar();
+			
+			ImGui::EndChild(); // channels pane
 			
-			// Step 4
-            std::string step_4_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep4])];
-            step_4_text.append("##step_4");
-            const char* step_4_lbl = step_4_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.125)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
+			ImGui::BeginChild("bottom pane", ImVec2(0, 0)); // bottom pane holds four colums
 			
-			if (ImGui::Button(step_4_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep4, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep4]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep4] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep4, fParameters[kParameterStep4]);
-			}
+			ImGui::BeginChild("bottom col one pane", ImVec2(UI_COLUMN_WIDTH, 0));
 			
-			if (fParameters[kParameterCurrentStep] == 0.125)
+			// Multiplier, of the lane being edited
+			const uint32_t multiplier_index = laneParameter(ui_lane, kLaneMultiplier);
+            if (ImGui::SliderInt("Step Multi", &ui_multiplier, static_cast<int>(controlLimits[multiplier_index].first), static_cast<int>(controlLimits[multiplier_index].second)))
             {
-				ImGui::PopStyleColor();
-			}
+                if (ImGui::IsItemActivated())
+                    editParameter(multiplier_index, true);
+                
+                fParameters[multiplier_index] = static_cast<float>(ui_multiplier);
+                setParameterValue(multiplier_index, fParameters[multiplier_index]);
+            }
 			
-			if (ImGui::IsItemDeactivated())
+			 if (ImGui::IsItemDeactivated())
             {
-                editParameter(kParameterStep4, false);
+                editParameter(multiplier_index, false);
             }
-			
-			ImGui::SameLine(); 
-			
-			// Step 5
-            std::string step_5_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep5])];
-            step_5_text.append("##step_5");
-            const char* step_5_lbl = step_5_text.c_str();
             
-            if (fParameters[kParameterCurrentStep] == 0.15625)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_5_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep5, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep5]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep5] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep5, fParameters[kParameterStep5]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.15625)
+            // Scale Glide
+            if (ImGui::SliderFloat("Glide", &fParameters[kParameterScaleGlide], controlLimits[kParameterScaleGlide].first, controlLimits[kParameterScaleGlide].second, "%.2f", ImGuiSliderFlags_Logarithmic|ImGuiSliderFlags_NoInput))
             {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
+                if (ImGui::IsItemActivated())
+                    editParameter(kParameterScaleGlide, true);
+
+                setParameterValue(kParameterScaleGlide, fParameters[kParameterScaleGlide]);
+            }
+
+            if (ImGui::IsItemDeactivated())
             {
-                editParameter(kParameterStep5, false);
+                editParameter(kParameterScaleGlide, false);
             }
-			
-			ImGui::SameLine(); 
-			
-			// Step 6
-            std::string step_6_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep6])];
-            step_6_text.append("##step_6");
-            const char* step_6_lbl = step_6_text.c_str();
             
-            if (fParameters[kParameterCurrentStep] == 0.1875)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
+			ImGui::EndChild(); // bottom col one pane
 			
-			if (ImGui::Button(step_6_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep6, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep6]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep6] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep6, fParameters[kParameterStep6]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.1875)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep6, false);
-            }
-			
-			ImGui::SameLine(); 
-			
-			// Step 7
-            std::string step_7_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep7])];
-            step_7_text.append("##step_7");
-            const char* step_7_lbl = step_7_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.21875)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_7_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep7, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep7]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep7] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep7, fParameters[kParameterStep7]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.21875)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep7, false);
-            }
-			
-			ImGui::SameLine(); 
-			
-			// Step 8
-            std::string step_8_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep8])];
-            step_8_text.append("##step_8");
-            const char* step_8_lbl = step_8_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.25)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_8_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep8, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep8]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep8] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep8, fParameters[kParameterStep8]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.25)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep8, false);
-            }
-			
-			ImGui::SameLine(); 
-			
-			// Step 9
-			std::string step_9_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep9])];
-            step_9_text.append("##step_9");
-            const char* step_9_lbl = step_9_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.28125)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_9_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep9, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep9]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep9] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep9, fParameters[kParameterStep9]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.28125)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep9, false);
-            }
-			
-			ImGui::SameLine(); 
-            
-            // Step 10
-            std::string step_10_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep10])];
-            step_10_text.append("##step_10");
-            const char* step_10_lbl = step_10_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.3125)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_10_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep10, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep10]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep10] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep10, fParameters[kParameterStep10]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.3125)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep10, false);
-            }
-			
-			ImGui::SameLine();
-			
-			// Step 11
-			std::string step_11_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep11])];
-            step_11_text.append("##step_11");
-            const char* step_11_lbl = step_11_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.34375)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_11_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep11, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep11]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep11] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep11, fParameters[kParameterStep11]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.34375)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep11, false);
-            }
-			
-			ImGui::SameLine();
-			
-			// Step 12
-			std::string step_12_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep12])];
-            step_12_text.append("##step_12");
-            const char* step_12_lbl = step_12_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.375)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_12_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep12, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep12]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep12] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep12, fParameters[kParameterStep12]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.375)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep12, false);
-            }
-			
-			ImGui::SameLine();
-			
-			// Step 13
-			std::string step_13_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep13])];
-            step_13_text.append("##step_13");
-            const char* step_13_lbl = step_13_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.40625)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_13_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep13, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep13]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep13] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep13, fParameters[kParameterStep13]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.40625)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep13, false);
-            }
-			
-			ImGui::SameLine();
-			
-			// Step 14
-			std::string step_14_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep14])];
-            step_14_text.append("##step_14");
-            const char* step_14_lbl = step_14_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.4375)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_14_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep14, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep14]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep14] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep14, fParameters[kParameterStep14]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.4375)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep14, false);
-            }
-			
-			ImGui::SameLine();
-			
-			// Step 15
-			std::string step_15_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep15])];
-            step_15_text.append("##step_15");
-            const char* step_15_lbl = step_15_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.46875)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_15_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep15, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep15]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep15] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep15, fParameters[kParameterStep15]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.46875)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep15, false);
-            }
-			
-			ImGui::SameLine();
-			
-			// Step 16
-			std::string step_16_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep16])];
-            step_16_text.append("##step_16");
-            const char* step_16_lbl = step_16_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.5)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_16_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep16, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep16]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep16] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep16, fParameters[kParameterStep16]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.5)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep16, false);
-            }
-            
-			ImGui::SameLine(); 
-            
-            // Step 17
-			std::string step_17_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep17])];
-            step_17_text.append("##step_17");
-            const char* step_17_lbl = step_17_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.53125)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_17_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep17, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep17]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep17] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep17, fParameters[kParameterStep17]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.53125)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep17, false);
-            }
-            
-			ImGui::SameLine(); 
-			
-			// Step 18
-			std::string step_18_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep18])];
-            step_18_text.append("##step_18");
-            const char* step_18_lbl = step_18_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.5625)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_18_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep18, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep18]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep18] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep18, fParameters[kParameterStep18]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.5625)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep18, false);
-            }
-            
-			ImGui::SameLine(); 
-			
-			// Step 19
-			std::string step_19_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep19])];
-            step_19_text.append("##step_19");
-            const char* step_19_lbl = step_19_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.59375)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_19_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep19, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep19]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep19] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep19, fParameters[kParameterStep19]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.59375)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep19, false);
-            }
-            
-			ImGui::SameLine(); 
-			
-			// Step 20
-			std::string step_20_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep20])];
-            step_20_text.append("##step_20");
-            const char* step_20_lbl = step_20_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.625)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_20_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep20, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep20]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep20] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep20, fParameters[kParameterStep20]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.625)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep20, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 21
-			std::string step_21_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep21])];
-            step_21_text.append("##step_21");
-            const char* step_21_lbl = step_21_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.65625)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_21_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep21, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep21]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep21] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep21, fParameters[kParameterStep21]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.65625)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep21, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 22
-			std::string step_22_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep22])];
-            step_22_text.append("##step_22");
-            const char* step_22_lbl = step_22_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.6875)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_22_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep22, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep22]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep22] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep22, fParameters[kParameterStep22]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.6875)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep22, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 23
-			std::string step_23_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep23])];
-            step_23_text.append("##step_23");
-            const char* step_23_lbl = step_23_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.71875)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_23_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep23, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep23]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep23] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep23, fParameters[kParameterStep23]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.71875)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep23, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 24
-			std::string step_24_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep24])];
-            step_24_text.append("##step_24");
-            const char* step_24_lbl = step_24_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.75)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_24_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep24, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep24]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep24] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep24, fParameters[kParameterStep24]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.75)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep24, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 25
-			std::string step_25_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep25])];
-            step_25_text.append("##step_25");
-            const char* step_25_lbl = step_25_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.78125)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_25_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep25, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep25]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep25] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep25, fParameters[kParameterStep25]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.78125)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep25, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 26
-			std::string step_26_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep26])];
-            step_26_text.append("##step_26");
-            const char* step_26_lbl = step_26_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.8125)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_26_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep26, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep26]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep26] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep26, fParameters[kParameterStep26]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.8125)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep26, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 27
-			std::string step_27_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep27])];
-            step_27_text.append("##step_27");
-            const char* step_27_lbl = step_27_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.84375)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_27_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep27, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep27]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep27] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep27, fParameters[kParameterStep27]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.84375)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep27, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 28
-			std::string step_28_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep28])];
-            step_28_text.append("##step_28");
-            const char* step_28_lbl = step_28_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.875)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_28_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep28, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep28]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep28] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep28, fParameters[kParameterStep28]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.875)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep28, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 29
-			std::string step_29_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep29])];
-            step_29_text.append("##step_29");
-            const char* step_29_lbl = step_29_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.90625)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_29_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep29, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep29]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep29] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep29, fParameters[kParameterStep29]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.90625)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep29, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 30
-			std::string step_30_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep30])];
-            step_30_text.append("##step_30");
-            const char* step_30_lbl = step_30_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.9375)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_30_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep30, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep30]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep30] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep30, fParameters[kParameterStep30]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.9375)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep30, false);
-            }
-            
-			ImGui::SameLine(); 
-
-            // Step 31
-			std::string step_31_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep31])];
-            step_31_text.append("##step_31");
-            const char* step_31_lbl = step_31_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 0.96875)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_31_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep31, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep31]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep31] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep31, fParameters[kParameterStep31]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 0.96875)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep31, false);
-            }
-            
-            ImGui::SameLine(); 
-
-            // Step 32
-			std::string step_32_text = scale_choice[static_cast<uint32_t>(fParameters[kParameterStep32])];
-            step_32_text.append("##step_32");
-            const char* step_32_lbl = step_32_text.c_str();
-            
-            if (fParameters[kParameterCurrentStep] == 1.0)
-            {
-				ImGui::PushStyleColor(ImGuiCol_Button, step_highlight_color);
-			}
-			
-			if (ImGui::Button(step_32_lbl, step_button_sz))
-			{
-				if (ImGui::IsItemActivated())
-                        editParameter(kParameterStep32, true);  
-                        
-				uint32_t cur_val = static_cast<uint32_t>(fParameters[kParameterStep32]);
-                cur_val += 1;
-				if (cur_val > 8)
-					cur_val = 1;
-				fParameters[kParameterStep32] = static_cast<float>(cur_val);
-                setParameterValue(kParameterStep32, fParameters[kParameterStep32]);
-			}
-			
-			if (fParameters[kParameterCurrentStep] == 1.0)
-            {
-				ImGui::PopStyleColor();
-			}
-			
-			if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterStep32, false);
-            }
-			
-			ImGui::PopFont();
-			
-			ImGui::EndChild(); // sequence pane
-			
-			ImGui::BeginChild("bottom pane", ImVec2(0, 0)); // bottom pane holds four colums
-			
-			ImGui::BeginChild("bottom col one pane", ImVec2(UI_COLUMN_WIDTH, 0));
-			
-			// Multiplier
-            if (ImGui::SliderInt("Step Multi", &ui_multiplier, static_cast<int>(controlLimits[kParameterMultiplier].first), static_cast<int>(controlLimits[kParameterMultiplier].second)))
-            {
-                if (ImGui::IsItemActivated())
-                    editParameter(kParameterMultiplier, true);
-                
-                fParameters[kParameterMultiplier] = static_cast<float>(ui_multiplier);
-                setParameterValue(kParameterMultiplier, fParameters[kParameterMultiplier]);
-            }
-			
-			 if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterMultiplier, false);
-            }
-            
-            // Scale Glide
-            if (ImGui::SliderFloat("Glide", &fParameters[kParameterScaleGlide], controlLimits[kParameterScaleGlide].first, controlLimits[kParameterScaleGlide].second, "%.2f", ImGuiSliderFlags_Logarithmic|ImGuiSliderFlags_NoInput))
-            {
-                if (ImGui::IsItemActivated())
-                    editParameter(kParameterScaleGlide, true);
-
-                setParameterValue(kParameterScaleGlide, fParameters[kParameterScaleGlide]);
-            }
-
-            if (ImGui::IsItemDeactivated())
-            {
-                editParameter(kParameterScaleGlide, false);
-            }
-            
-			ImGui::EndChild(); // bottom col one pane
-			
-			ImGui::SameLine();
+			ImGui::SameLine();
 			
 			ImGui::BeginChild("bottom col two pane", ImVec2(UI_COLUMN_WIDTH, 0));
 			
@@ -1963,6 +1053,29 @@ protected:
             
             ImGui::SameLine(0, measure_style.ItemInnerSpacing.x);
             ImGui::Text("Step Type");
+            
+            // MPE output
+            if (ImGui::Checkbox("MPE Out", &ui_mpeOutput))
+            {
+                editParameter(kParameterMpeOutput, true);
+                fParameters[kParameterMpeOutput] = ui_mpeOutput ? 1.0f : 0.0f;
+                setParameterValue(kParameterMpeOutput, fParameters[kParameterMpeOutput]);
+                editParameter(kParameterMpeOutput, false);
+            }
+            
+            if (ImGui::SliderInt("Bend Range", &ui_mpeBendRange, static_cast<int>(controlLimits[kParameterMpeBendRange].first), static_cast<int>(controlLimits[kParameterMpeBendRange].second)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(kParameterMpeBendRange, true);
+                
+                fParameters[kParameterMpeBendRange] = static_cast<float>(ui_mpeBendRange);
+                setParameterValue(kParameterMpeBendRange, fParameters[kParameterMpeBendRange]);
+            }
+            
+            if (ImGui::IsItemDeactivated())
+            {
+                editParameter(kParameterMpeBendRange, false);
+            }
             		
 			ImGui::EndChild(); // bottom col two pane
 			
@@ -1970,19 +1083,64 @@ protected:
 			
 			ImGui::BeginChild("bottom col three pane", ImVec2(UI_COLUMN_WIDTH, 0));
 			
-			// Loop Point
-            if (ImGui::SliderInt("Loop Point", &ui_loopPoint, static_cast<int>(controlLimits[kParameterLoopPoint].first), static_cast<int>(controlLimits[kParameterLoopPoint].second)))
+			// Loop Point, of the lane being edited
+			const uint32_t loop_point_index = laneParameter(ui_lane, kLaneLoopPoint);
+            if (ImGui::SliderInt("Loop Point", &ui_loopPoint, static_cast<int>(controlLimits[loop_point_index].first), static_cast<int>(controlLimits[loop_point_index].second)))
             {
                 if (ImGui::IsItemActivated())
-                    editParameter(kParameterLoopPoint, true);
+                    editParameter(loop_point_index, true);
                 
-                fParameters[kParameterLoopPoint] = static_cast<float>(ui_loopPoint);
-                setParameterValue(kParameterLoopPoint, fParameters[kParameterLoopPoint]);
+                fParameters[loop_point_index] = static_cast<float>(ui_loopPoint);
+                setParameterValue(loop_point_index, fParameters[loop_point_index]);
             }
 			
 			 if (ImGui::IsItemDeactivated())
             {
-                editParameter(kParameterLoopPoint, false);
+                editParameter(loop_point_index, false);
+            }
+            
+            // SysEx output
+            const char* sysex_modes[3] = { "Off", "Single Note", "Bulk Dump"};
+            const char* current_sysex_mode = sysex_modes[static_cast<int32_t>(fParameters[kParameterSysExMode])];
+            
+            if (ImGui::BeginCombo("SysEx Out", current_sysex_mode))
+            {
+                for (int n = 0; n < IM_ARRAYSIZE(sysex_modes); n++)
+                {
+                    bool is_selected = (current_sysex_mode == sysex_modes[n]);
+                    if (ImGui::Selectable(sysex_modes[n], is_selected))
+                    {
+                        editParameter(kParameterSysExMode, true);
+                        fParameters[kParameterSysExMode] = static_cast<float>(n);
+                        setParameterValue(kParameterSysExMode, fParameters[kParameterSysExMode]);
+                        editParameter(kParameterSysExMode, false);
+                    }
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+            
+            // When MIDI Note stepping starts over
+            const EnumerationDescriptor& step_resets(kEnumerationDescriptors[kEnumStepReset]);
+            const int32_t current_step_reset = static_cast<int32_t>(fParameters[kParameterStepReset]);
+            
+            if (ImGui::BeginCombo("Step Reset", step_resets.labels[current_step_reset]))
+            {
+                for (int32_t n = 0; n < static_cast<int32_t>(step_resets.count); n++)
+                {
+                    bool is_selected = (current_step_reset == n);
+                    if (ImGui::Selectable(step_resets.labels[n], is_selected))
+                    {
+                        editParameter(kParameterStepReset, true);
+                        fParameters[kParameterStepReset] = static_cast<float>(n);
+                        setParameterValue(kParameterStepReset, fParameters[kParameterStepReset]);
+                        editParameter(kParameterStepReset, false);
+                    }
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
             }
             
 			ImGui::EndChild(); // bottom col three pane
@@ -2004,6 +1162,52 @@ protected:
             {
                 editParameter(kParameterOffset, false);
             }
+            
+            // Limit SysEx to what a 5-pin DIN MIDI link can carry
+            if (ImGui::Checkbox("SysEx DIN Rate", &ui_sysexDinRate))
+            {
+                editParameter(kParameterSysExDinRate, true);
+                fParameters[kParameterSysExDinRate] = ui_sysexDinRate ? 1.0f : 0.0f;
+                setParameterValue(kParameterSysExDinRate, fParameters[kParameterSysExDinRate]);
+                editParameter(kParameterSysExDinRate, false);
+            }
+            
+            // Lanes playing
+            if (ImGui::SliderInt("Lanes", &ui_lanes, static_cast<int>(controlLimits[kParameterLanes].first), static_cast<int>(controlLimits[kParameterLanes].second)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(kParameterLanes, true);
+                
+                fParameters[kParameterLanes] = static_cast<float>(ui_lanes);
+                setParameterValue(kParameterLanes, fParameters[kParameterLanes]);
+            }
+            
+            if (ImGui::IsItemDeactivated())
+            {
+                editParameter(kParameterLanes, false);
+            }
+            
+            // How the lanes make up the scale of the sequence
+            const EnumerationDescriptor& lane_combines(kEnumerationDescriptors[kEnumLaneCombine]);
+            const int32_t current_lane_combine = static_cast<int32_t>(fParameters[kParameterLaneCombine]);
+            
+            if (ImGui::BeginCombo("Lane Combine", lane_combines.labels[current_lane_combine]))
+            {
+                for (int32_t n = 0; n < static_cast<int32_t>(lane_combines.count); n++)
+                {
+                    bool is_selected = (current_lane_combine == n);
+                    if (ImGui::Selectable(lane_combines.labels[n], is_selected))
+                    {
+                        editParameter(kParameterLaneCombine, true);
+                        fParameters[kParameterLaneCombine] = static_cast<float>(n);
+                        setParameterValue(kParameterLaneCombine, fParameters[kParameterLaneCombine]);
+                        editParameter(kParameterLaneCombine, false);
+                    }
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
 			
 			ImGui::EndChild(); // bottom col four pane
 			
@@ -2023,6 +1227,371 @@ protected:
                        
 		}
 		ImGui::End();
+		
+		if (ui_showTuningView)
+			drawTuningView();
+		
+		if (ui_showPerfStats)
+			drawPerfStats();
+		
+		if (ui_showLibrary)
+			drawLibrary();
+    }
+    
+   /**
+      Floating window for browsing the scale library index: scan directories, search by name or description,
+      preview a scale and load it into one of the eight slots.
+    */
+    void drawLibrary()
+    {
+        ImGui::SetNextWindowPos(ImVec2(UI_COLUMN_WIDTH / 2, ImGui::GetFontSize() * 4), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(UI_COLUMN_WIDTH * 2, 420 * scale_factor), ImGuiCond_FirstUseEver);
+        
+        if (ImGui::Begin("Scale Library", &ui_showLibrary, ImGuiWindowFlags_NoCollapse))
+        {
+            ImGui::PushFont(lektonRegularFont);
+            
+            // Directories to scan
+            ImGui::PushItemWidth(-UI_COLUMN_WIDTH / 3);
+            ImGui::InputTextWithHint("##library_roots", "Folders to scan, separated by ;", ui_libraryRoots, sizeof(ui_libraryRoots));
+            ImGui::PopItemWidth();
+            ImGui::SameLine();
+            
+            if (fLibraryScanner.isRunning())
+            {
+                ImGui::Text("%u / %u", fLibraryScanner.getFilesParsed(), fLibraryScanner.getFilesToParse());
+            }
+            else if (ImGui::Button("Scan"))
+            {
+#ifdef _WIN32
+                // The scanner can't replace the index file while it is mapped
+                ScaleLibraryIndex previous;
+                previous.open(fLibraryIndexPath);
+                fLibrary.close();
+                fLibraryMatches.clear();
+                fLibraryScanner.start(ui_libraryRoots, fLibraryIndexPath, previous);
+                previous.close();
+#else
+                fLibraryScanner.start(ui_libraryRoots, fLibraryIndexPath, fLibrary);
+#endif
+            }
+            
+            // Search
+            ImGui::PushItemWidth(-1);
+            if (ImGui::InputTextWithHint("##library_search", "Search", ui_librarySearch, sizeof(ui_librarySearch)))
+                updateLibraryMatches();
+            ImGui::PopItemWidth();
+            
+            ImGui::Text("%u of %u scales", static_cast<uint32_t>(fLibraryMatches.size()), fLibrary.getEntryCount());
+            
+            // Results
+            const float previewHeight = 80 * scale_factor;
+            const float listHeight = ImGui::GetContentRegionAvail().y - previewHeight - ImGui::GetFrameHeight() * 2;
+            
+            if (ImGui::BeginListBox("##library_list", ImVec2(-1, std::max(listHeight, ImGui::GetFrameHeight() * 3))))
+            {
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(fLibraryMatches.size()));
+                while (clipper.Step())
+                {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+                    {
+                        const uint32_t index = fLibraryMatches[row];
+                        const ScaleLibraryEntry& entry(fLibrary.getEntry(index));
+                        
+                        ImGui::PushID(static_cast<int>(index));
+                        if (ImGui::Selectable(fLibrary.getString(entry.name), fLibrarySelected == static_cast<int32_t>(index)))
+                            fLibrarySelected = static_cast<int32_t>(index);
+                        if (ImGui::IsItemHovered() && fLibrary.getString(entry.description)[0] != '\0')
+                            ImGui::SetTooltip("%s", fLibrary.getString(entry.description));
+                        ImGui::PopID();
+                    }
+                }
+                clipper.End();
+                ImGui::EndListBox();
+            }
+            
+            // Preview of the selected scale, as cents away from 12-TET
+            if (fLibrarySelected >= 0 && static_cast<uint32_t>(fLibrarySelected) < fLibrary.getEntryCount())
+            {
+                const ScaleLibraryEntry& entry(fLibrary.getEntry(static_cast<uint32_t>(fLibrarySelected)));
+                
+                ImGui::Text("%d notes, period %.3f cents", entry.noteCount, entry.period);
+                
+                const ImVec2 origin(ImGui::GetCursorScreenPos());
+                const ImVec2 size(ImGui::GetContentRegionAvail().x, previewHeight);
+                ImGui::Dummy(size);
+                
+                float range = 50.0f;
+                for (int32_t i = 0; i < 128; i++)
+                    range = std::max(range, std::fabs(entry.cents[i]));
+                range = std::ceil(range / 50.0f) * 50.0f;
+                
+                const float middle = origin.y + size.y * 0.5f;
+                for (int32_t i = 0; i < 128; i++)
+                    fLibraryPoints[i] = ImVec2(origin.x + i * size.x / 127.0f, middle - 0.5f * size.y * entry.cents[i] / range);
+                
+                ImDrawList* const drawList = ImGui::GetWindowDrawList();
+                drawList->AddRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), ImGui::GetColorU32(ImGuiCol_Border));
+                drawList->AddPolyline(fLibraryPoints, 128, ImGui::GetColorU32(ImGuiCol_PlotLines), 0, 1.5f * scale_factor);
+                
+                ImGui::PushItemWidth(UI_COLUMN_WIDTH / 3);
+                ImGui::SliderInt("##library_slot", &ui_librarySlot, 1, 8, "Scale %d");
+                ImGui::PopItemWidth();
+                ImGui::SameLine();
+                
+                if (ImGui::Button("Load"))
+                {
+                    const States stateId = static_cast<States>(kStateFileSCL1 + ui_librarySlot - 1);
+                    const char* const path = fLibrary.getString(entry.path);
+                    setState(kStateDescriptors[stateId].key, path);
+                    tuningFileChanged(stateId, path);
+                }
+            }
+            
+            ImGui::PopFont();
+        }
+        ImGui::End();
+    }
+    
+   /**
+      Search the index for every word typed, in the name or the description, ignoring case.
+      A linear pass over the mapped entries; fast enough for tens of thousands of scales.
+    */
+    void updateLibraryMatches()
+    {
+        fLibraryMatches.clear();
+        
+        std::vector<std::string> words;
+        std::string word;
+        for (const char* c = ui_librarySearch; ; ++c)
+        {
+            if (*c == ' ' || *c == '\0')
+            {
+                if (!word.empty())
+                    words.push_back(word);
+                word.clear();
+                if (*c == '\0')
+                    break;
+            }
+            else
+            {
+                word.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(*c))));
+            }
+        }
+        
+        std::string text;
+        for (uint32_t i = 0; i < fLibrary.getEntryCount(); i++)
+        {
+            const ScaleLibraryEntry& entry(fLibrary.getEntry(i));
+            
+            text = fLibrary.getString(entry.name);
+            text += ' ';
+            text += fLibrary.getString(entry.description);
+            std::transform(text.begin(), text.end(), text.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+            
+            bool match = true;
+            for (const std::string& w : words)
+            {
+                if (text.find(w) == std::string::npos)
+                {
+                    match = false;
+                    break;
+                }
+            }
+            
+            if (match)
+                fLibraryMatches.push_back(i);
+        }
+        
+        if (fLibrarySelected >= 0 && static_cast<uint32_t>(fLibrarySelected) >= fLibrary.getEntryCount())
+            fLibrarySelected = -1;
+    }
+    
+    void openLibrary()
+    {
+        fLibrary.open(fLibraryIndexPath);
+        std::snprintf(ui_libraryRoots, sizeof(ui_libraryRoots), "%s", fLibrary.getRoots());
+        fLibrarySelected = -1;
+        updateLibraryMatches();
+    }
+    
+   /**
+      Floating window with the DSP statistics recorded by the plugin. Times are shown against the block budget,
+      the time one block of audio lasts at the current sample rate and block size.
+    */
+    void drawPerfStats()
+    {
+        ImGui::SetNextWindowPos(ImVec2(UI_COLUMN_WIDTH * 2, ImGui::GetFontSize() * 4), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(UI_COLUMN_WIDTH, 280 * scale_factor), ImGuiCond_FirstUseEver);
+        
+        if (ImGui::Begin("DSP Load", &ui_showPerfStats, ImGuiWindowFlags_NoCollapse))
+        {
+            ImGui::PushFont(lektonRegularFont);
+            
+            const PerfStatsSnapshot& st(fPerfStatsSnapshot);
+            const double sampleRate = getSampleRate();
+            
+            if (st.blocks == 0 || st.ticksPerSecond <= 0.0 || sampleRate <= 0.0)
+            {
+                ImGui::TextDisabled("No blocks processed yet");
+            }
+            else
+            {
+                const double usPerTick = 1e6 / st.ticksPerSecond;
+                const double budget = 1e6 * st.lastFrames / sampleRate;
+                const double mean = usPerTick * static_cast<double>(st.totalTicks) / static_cast<double>(st.blocks);
+                const double p99 = usPerTick * st.percentileTicks(0.99);
+                const double worst = usPerTick * static_cast<double>(st.maxTicks);
+                const double seconds = static_cast<double>(st.frames) / sampleRate;
+                
+                ImGui::Text("%u frames at %.0f Hz: %.0f us budget", st.lastFrames, sampleRate, budget);
+                ImGui::Separator();
+                ImGui::Text("Mean  %8.1f us  %5.1f %%", mean, 100.0 * mean / budget);
+                ImGui::Text("p99   %8.1f us  %5.1f %%", p99, 100.0 * p99 / budget);
+                ImGui::Text("Max   %8.1f us  %5.1f %%", worst, 100.0 * worst / budget);
+                ImGui::Separator();
+                ImGui::Text("MTS-ESP publishes  %.0f /s", seconds > 0.0 ? st.publishes / seconds : 0.0);
+                ImGui::Text("Gliding  %.1f %% of the time", 100.0 * st.glideFrames / static_cast<double>(st.frames));
+                
+                ImGui::PlotHistogram("##block_times", fPerfHistogram + fPerfHistogramStart, fPerfHistogramCount, 0, "Block time", 0.0f, 3.4e38f, ImVec2(-1, 60 * scale_factor));
+            }
+            
+            if (ImGui::Button("Reset"))
+                fShared->resetPerfStats();
+            
+            ImGui::PopFont();
+        }
+        ImGui::End();
+    }
+    
+   /**
+      Read the statistics and narrow the histogram down to the bins in use.
+    */
+    void updatePerfStats()
+    {
+        fShared->readPerfStats(fPerfStatsSnapshot);
+        
+        uint32_t first = PerfStatsSnapshot::kBins;
+        uint32_t last = 0;
+        
+        for (uint32_t i = 0; i < PerfStatsSnapshot::kBins; i++)
+        {
+            fPerfHistogram[i] = static_cast<float>(fPerfStatsSnapshot.histogram[i]);
+            if (fPerfStatsSnapshot.histogram[i] != 0)
+            {
+                first = std::min(first, i);
+                last = i;
+            }
+        }
+        
+        fPerfHistogramStart = first < PerfStatsSnapshot::kBins ? first : 0;
+        fPerfHistogramCount = first < PerfStatsSnapshot::kBins ? static_cast<int>(last - first + 1) : 0;
+    }
+    
+   /**
+      Floating window plotting the published tuning table and the table being glided to, as cents away from 12-TET.
+      Each table is a single polyline, computed in updateTuningView() when a new snapshot arrives.
+    */
+    void drawTuningView()
+    {
+        ImGui::SetNextWindowPos(ImVec2(UI_COLUMN_WIDTH, ImGui::GetFontSize() * 4), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(UI_COLUMN_WIDTH * 2, 260 * scale_factor), ImGuiCond_FirstUseEver);
+        
+        if (ImGui::Begin("Tuning View", &ui_showTuningView, ImGuiWindowFlags_NoCollapse))
+        {
+            ImGui::PushFont(lektonRegularFont);
+            
+            if (fTuningSnapshotSeen == 0)
+            {
+                ImGui::TextDisabled("Nothing published yet");
+            }
+            else
+            {
+                if (fTuningSnapshot.scale > 0)
+                    ImGui::Text("Scale %d", fTuningSnapshot.scale);
+                else
+                    ImGui::Text("Standard tuning");
+                ImGui::SameLine(UI_COLUMN_WIDTH / 2);
+                ImGui::ProgressBar(fGlideProgress, ImVec2(-1, 0), fGlideProgress < 1.0f ? "Gliding" : "Arrived");
+                
+                const ImVec2 origin(ImGui::GetCursorScreenPos());
+                const ImVec2 size(ImGui::GetContentRegionAvail());
+                ImGui::Dummy(size);
+                
+                if (size.x > 0.0f && size.y > 0.0f)
+                {
+                    ImDrawList* const drawList = ImGui::GetWindowDrawList();
+                    const ImU32 lineColor = ImGui::GetColorU32(ImGuiCol_Border);
+                    const float middle = origin.y + size.y * 0.5f;
+                    const float xScale = size.x / 127.0f;
+                    const float yScale = -0.5f * size.y / fCentsRange;
+                    
+                    drawList->AddRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), lineColor);
+                    drawList->AddLine(ImVec2(origin.x, middle), ImVec2(origin.x + size.x, middle), lineColor);
+                    
+                    char label[32];
+                    std::snprintf(label, sizeof(label), "+%.0f cents", fCentsRange);
+                    drawList->AddText(ImVec2(origin.x + 4.0f, origin.y + 2.0f), lineColor, label);
+                    
+                    for (int32_t i = 0; i < 128; i++)
+                    {
+                        fTargetPoints[i] = ImVec2(origin.x + i * xScale, middle + fTargetCents[i] * yScale);
+                        fCurrentPoints[i] = ImVec2(origin.x + i * xScale, middle + fCurrentCents[i] * yScale);
+                    }
+                    
+                    drawList->PushClipRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), true);
+                    drawList->AddPolyline(fTargetPoints, 128, ImGui::GetColorU32(ImGuiCol_PlotLines), 0, 1.0f);
+                    drawList->AddPolyline(fCurrentPoints, 128, ImGui::GetColorU32(ImGuiCol_PlotHistogram), 0, 2.0f * scale_factor);
+                    drawList->PopClipRect();
+                }
+            }
+            
+            ImGui::PopFont();
+        }
+        ImGui::End();
+    }
+    
+   /**
+      Work out the cents deviation of each note, the plot range and how far the glide has come from a new snapshot.
+    */
+    void updateTuningView()
+    {
+        float range = 50.0f;
+        double remaining = 0.0;
+        double total = 0.0;
+        
+        for (int32_t i = 0; i < 128; i++)
+        {
+            const double equal = 440.0 * std::exp2((i - 69) / 12.0);
+            const double current = fTuningSnapshot.current[i] > 0.0f ? fTuningSnapshot.current[i] : equal;
+            const double target = fTuningSnapshot.target[i] > 0.0f ? fTuningSnapshot.target[i] : equal;
+            const double from = fTuningSnapshot.origin[i] > 0.0f ? fTuningSnapshot.origin[i] : equal;
+            
+            fCurrentCents[i] = static_cast<float>(1200.0 * std::log2(current / equal));
+            fTargetCents[i] = static_cast<float>(1200.0 * std::log2(target / equal));
+            
+            range = std::max(range, std::max(std::fabs(fCurrentCents[i]), std::fabs(fTargetCents[i])));
+            remaining += std::fabs(std::log2(current / target));
+            total += std::fabs(std::log2(from / target));
+        }
+        
+        // Round the range up to 50 cents so it doesn't jump around with every snapshot
+        fCentsRange = std::ceil(range / 50.0f) * 50.0f;
+        fGlideProgress = total > 0.0 ? static_cast<float>(limit(1.0 - remaining / total, 0.0, 1.0)) : 1.0f;
+    }
+
+    // -------------------------------------------------------------------------------------------------------
+    // Step grid
+
+    void editStep(uint32_t index, bool started) override
+    {
+        editParameter(index, started);
+    }
+
+    void setStep(uint32_t index, float value) override
+    {
+        setParameterValue(index, value);
     }
 
     // -------------------------------------------------------------------------------------------------------
@@ -2035,8 +1604,10 @@ private:
     String fState[kStateCount];
     String fFileBaseName[kStateCount];
     
-    Tunings::Tuning utuning1, utuning2, utuning3, utuning4,
-                    utuning5, utuning6, utuning7, utuning8;
+    // Tuning file info as last reported by the plugin
+    ScaleSequencePlusShared* fShared;
+    TuningFileInfo fTuningFileInfo[kStateCount];
+    uint32_t fTuningFileInfoVersion;
     
     // UI stuff
     double scale_factor;
@@ -2046,13 +1617,57 @@ private:
     ImFont* brunoAceStepFont;
     ImFont* brunoAceSCFont;
     ImFont* lektonRegularFont;
+    ImGuiIO* fImGuiIO;
+    ImFontAtlas* fOwnFontAtlas;
+    ImTextureID fFontTexture;
     
     bool show_error_popup;
     String errorText;
+    
+    // Set when something shown on screen changed on the plugin side, handled in uiIdle()
+    bool fRepaintPending;
 
     // int and bool variables required for Dear ImGui SliderInt and CheckBox widgets.
+    int ui_lane;    // lane shown in the sequence pane, counting from 0
+    int ui_lanes;
     int ui_multiplier;
 	int ui_loopPoint;
+	bool ui_multiChannel;
+	bool ui_sysexDinRate;
+	bool ui_mpeOutput;
+	int ui_mpeBendRange;
+	bool ui_showTuningView;
+	
+	// Tuning view, see drawTuningView()
+	TuningSnapshot fTuningSnapshot;
+	uint32_t fTuningSnapshotSeen;
+	float fCurrentCents[128];
+	float fTargetCents[128];
+	ImVec2 fCurrentPoints[128];
+	ImVec2 fTargetPoints[128];
+	float fCentsRange;
+	float fGlideProgress;
+	
+	// DSP load overlay, see drawPerfStats()
+	bool ui_showPerfStats;
+	PerfStatsSnapshot fPerfStatsSnapshot;
+	float fPerfHistogram[PerfStatsSnapshot::kBins];
+	uint32_t fPerfHistogramStart;
+	int fPerfHistogramCount;
+	uint32_t fPerfStatsIdleCount;
+	
+	// Scale library browser, see drawLibrary()
+	bool ui_showLibrary;
+	char ui_libraryRoots[1024];
+	char ui_librarySearch[128];
+	int ui_librarySlot;
+	std::string fLibraryIndexPath;
+	ScaleLibraryIndex fLibrary;
+	ScaleLibraryScanner fLibraryScanner;
+	std::vector<uint32_t> fLibraryMatches;
+	int32_t fLibrarySelected;
+	ImVec2 fLibraryPoints[128];
+	uint32_t fLibraryIdleCount;
     
 
     
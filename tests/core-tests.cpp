@@ -0,0 +1,981 @@
+/*
+ * Tests of the sequencer core (the scalesequence-core library the plugin is built on), run by CTest.
+ *
+ * Each test plays a host transport into a core publishing to a RecordingTuningSink, with the eight scale slots
+ * loaded with equal divisions of the octave (12, 19, 22, 31, 17, 24, 15 and 53 EDO), and checks the steps the core
+ * is on and the tables it published:
+ *   beats          steps start on the frame of each beat
+ *   bars           steps start on the frame of each bar
+ *   note           every note on advances the step, and the MIDI is passed through
+ *   loop-points    the sequence and the lanes go back to their first step at their loop points
+ *   scale-switch   a step with another scale starts a glide from its first frame, and the table arrives there
+ *   glide          the table follows the glide curve and converges, then is published once per block
+ *   glide-accuracy every table published while gliding through all eight scales, at glide settings from 1 to 100,
+ *                  against the double-precision glide worked out here, frame by frame
+ *   offline-glide  the closed-form glide for offline rendering arrives at the same tables as the one run per frame
+ *   reload         a slot loaded from another thread while the core runs on it is glided to once loaded
+ *   mts-encoding   MTS frequency data, up to the top of the range, which must never come out as 7F 7F 7F
+ *   not-master     without the MTS-ESP master the table still follows the sequence, for the SysEx output
+ *   switch-frame   the SysEx and the MPE bends for a scale switch go out on its frame, in order with the MIDI
+ *   din-rate       the SysEx keeps all the MIDI the core writes, the MPE output included, to the DIN rate
+ *   mpe-note-off   a note off for a note the MPE output is not playing goes out as it came in
+ *   bypass         a bypassed core passes its MIDI through untouched
+ *   handover       another core takes over the master when the master is bypassed, without run() waiting for it,
+ *                  and starts on the scale its sequence is on
+ *
+ * Usage: scalesequence-core-tests [<test>...]
+ * Runs the named tests, or all of them. The exit code is 1 if any check failed.
+ *
+ * The tests are also built against a core with SCALESEQUENCE_PLUS_FLOAT_GLIDE on, as
+ * scalesequence-core-float-glide-tests, where published tables only have to be within 0.01 cents.
+ */
+
+#include "ScaleSequencePlusCore.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const int32_t kEdos[8] = { 12, 19, 22, 31, 17, 24, 15, 53 };
+static const double kSampleRate = 48000.0;
+
+// How close a published table has to be to the expected one. The float glide is only as close as 0.01 cents.
+static const double kToleranceInCents = SCALESEQUENCE_PLUS_FLOAT_GLIDE ? 0.01 : 1e-6;
+
+static uint32_t gFailures = 0;
+static fs::path gScaleDir;
+
+static void check(bool condition, const char* text, const char* file, int line)
+{
+    if (condition)
+        return;
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+    gFailures++;
+}
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static fs::path scalePath(int32_t slot)
+{
+    return gScaleDir / (std::to_string(kEdos[slot - 1]) + "edo.scl");
+}
+
+static bool writeScales(const fs::path& dir)
+{
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    for (int32_t slot = 0; slot < 8; slot++)
+    {
+        std::ofstream file(dir / (std::to_string(kEdos[slot]) + "edo.scl"));
+        file << "! " << kEdos[slot] << "edo.scl\n" << kEdos[slot] << " equal divisions of the octave\n " << kEdos[slot] << "\n!\n";
+        for (int32_t i = 1; i <= kEdos[slot]; i++)
+            file << " " << (1200.0 * i / kEdos[slot]) << "\n";
+        if (!file)
+            return false;
+    }
+    return true;
+}
+
+/**
+   The table of scale slot @a slot, worked out by the tuning library on its own.
+ */
+static std::vector<double> scaleTable(int32_t slot)
+{
+    const Tunings::Tuning tuning(Tunings::readSCLFile(scalePath(slot).string()));
+    std::vector<double> table(128);
+    for (int32_t i = 0; i < 128; i++)
+        table[i] = tuning.frequencyForMidiNote(i);
+    return table;
+}
+
+/**
+   The largest difference between two tables, in cents.
+ */
+static double tableDistance(const double* published, const std::vector<double>& expected)
+{
+    double distance = 0.0;
+    for (int32_t i = 0; i < 128; i++)
+        distance = std::max(distance, std::fabs(1200.0 * std::log2(published[i] / expected[i])));
+    return distance;
+}
+
+/**
+   Keeps the MIDI output, and the tuning it sent over SysEx as MTS frequency data per note.
+ */
+class TestHost : public ScaleSequencePlusHost
+{
+public:
+    std::vector<ScaleSequencePlusMidiEvent> midiOut;
+    uint32_t sysExMessages = 0;
+    uint8_t sysExWords[128][3] = {};
+
+    void sendMidiEvent(const ScaleSequencePlusMidiEvent& event) override
+    {
+        midiOut.push_back(event);
+
+        // Real-time single note tuning changes
+        const uint8_t* const data = event.dataExt;
+        if (event.size <= ScaleSequencePlusMidiEvent::kDataSize || data == nullptr || data[1] != 0x7F || data[4] != 0x02)
+            return;
+
+        for (uint32_t i = 0; i < data[6]; i++)
+            std::memcpy(sysExWords[data[kMtsNoteChangeHeaderSize + 4 * i]], data + kMtsNoteChangeHeaderSize + 4 * i + 1, 3);
+        sysExMessages++;
+    }
+
+    void tuningFileInfoChanged(States, const TuningFileInfo&) override
+    {
+    }
+};
+
+/**
+   A core publishing to a RecordingTuningSink, with the scale slots loaded, played by a 4/4 transport rolling from
+   the start of the song at a fixed tempo.
+ */
+class Session
+{
+public:
+    TestHost host;
+    RecordingTuningSink sink;
+    ScaleSequencePlusCore core;
+
+    explicit Session(double bpm = 120.0)
+        : core(host),
+          fBeatsPerMinute(bpm),
+          fFrame(0)
+    {
+        core.setTuningSink(&sink);
+        for (int32_t slot = 1; slot <= 8; slot++)
+            core.loadScl(slot, scalePath(slot).string().c_str());
+    }
+
+    ~Session()
+    {
+        core.deactivate();
+    }
+
+    double framesPerBeat() const
+    {
+        return kSampleRate * 60.0 / fBeatsPerMinute;
+    }
+
+    uint64_t frame() const
+    {
+        return fFrame;
+    }
+
+   /**
+      Run one block, starting where the last one ended.
+    */
+    void run(uint32_t frames, const std::vector<ScaleSequencePlusMidiEvent>& events = std::vector<ScaleSequencePlusMidiEvent>())
+    {
+        const double ticksPerBeat = 1920.0;
+        const double beats = fFrame / framesPerBeat();
+        const int64_t wholeBeats = static_cast<int64_t>(beats);
+
+        ScaleSequencePlusTransport transport = {};
+        transport.playing = true;
+        transport.frame = fFrame;
+        transport.bbt.valid = true;
+        transport.bbt.bar = static_cast<int32_t>(wholeBeats / 4) + 1;
+        transport.bbt.beat = static_cast<int32_t>(wholeBeats % 4) + 1;
+        transport.bbt.tick = (beats - wholeBeats) * ticksPerBeat;
+        transport.bbt.ticksPerBeat = ticksPerBeat;
+        transport.bbt.beatsPerBar = 4.0f;
+        transport.bbt.beatsPerMinute = fBeatsPerMinute;
+
+        core.run(frames, transport, events.data(), static_cast<uint32_t>(events.size()));
+        fFrame += frames;
+    }
+
+   /**
+      The step lane @a lane is on, counting from 0. The output starts out on the last step, before the sequence does.
+    */
+    int32_t step(int32_t lane = 0) const
+    {
+        return static_cast<int32_t>(std::lround(core.getParameterValue(laneParameter(lane, kLaneCurrentStep)) * 32.0f)) - 1;
+    }
+
+private:
+    double fBeatsPerMinute;
+    uint64_t fFrame;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static void testBeats()
+{
+    Session session;
+    for (int32_t step = 0; step < kNumSteps; step++)
+        session.core.setParameterValue(kParameterStep1 + step, static_cast<float>(1 + step % 8));
+    session.core.setParameterValue(kParameterMeasure, kStepBeats);
+    session.core.activate(kSampleRate);
+
+    // Blocks of 256 frames, so beats start within blocks; a step starts on the first frame at or after its beat
+    const double framesPerBeat = session.framesPerBeat();
+    while (session.frame() < 10 * framesPerBeat)
+    {
+        session.run(256);
+        const uint64_t last = session.frame() - 1;
+        CHECK(session.step() == static_cast<int32_t>(std::floor(last / framesPerBeat)) % kNumSteps);
+    }
+    CHECK(session.sink.hasMaster());
+}
+
+static void testBars()
+{
+    Session session;
+    for (int32_t step = 0; step < kNumSteps; step++)
+        session.core.setParameterValue(kParameterStep1 + step, static_cast<float>(1 + step % 8));
+    session.core.setParameterValue(kParameterMeasure, kStepBars);
+    session.core.setParameterValue(kParameterMultiplier, 2.0f);
+    session.core.activate(kSampleRate);
+
+    // A step every two bars of 4/4
+    const double framesPerStep = 8 * session.framesPerBeat();
+    while (session.frame() < 9 * framesPerStep)
+    {
+        session.run(1000);
+        const uint64_t last = session.frame() - 1;
+        CHECK(session.step() == static_cast<int32_t>(std::floor(last / framesPerStep)) % kNumSteps);
+    }
+}
+
+static void testNote()
+{
+    Session session;
+    session.core.setParameterValue(kParameterMeasure, kStepMidiNote);
+    session.core.activate(kSampleRate);
+
+    session.run(256);
+    CHECK(session.step() == kNumSteps - 1);
+
+    // Note ons advance the step, note offs and other messages don't
+    std::vector<ScaleSequencePlusMidiEvent> events;
+    events.push_back({ 10, 3, { 0x90, 60, 100, 0 }, nullptr });
+    events.push_back({ 20, 3, { 0x80, 60, 0, 0 }, nullptr });
+    events.push_back({ 30, 3, { 0xB0, 1, 64, 0 }, nullptr });
+    session.run(256, events);
+    CHECK(session.step() == 0);
+    CHECK(session.host.midiOut.size() == 3);
+
+    events.clear();
+    events.push_back({ 0, 3, { 0x90, 60, 100, 0 }, nullptr });
+    events.push_back({ 5, 3, { 0x91, 64, 100, 0 }, nullptr });
+    events.push_back({ 9, 3, { 0x92, 67, 100, 0 }, nullptr });
+    session.run(256, events);
+    CHECK(session.step() == 3);
+    CHECK(session.host.midiOut.size() == 6);
+
+    // Blocks without notes leave the step where it is
+    session.run(256);
+    CHECK(session.step() == 3);
+}
+
+static void testLoopPoints()
+{
+    // Beats, lane 1 looping every 3 steps and lane 2 every 5
+    {
+        Session session;
+        session.core.setParameterValue(kParameterMeasure, kStepBeats);
+        session.core.setParameterValue(kParameterLanes, 2.0f);
+        session.core.setParameterValue(kParameterLoopPoint, 3.0f);
+        session.core.setParameterValue(laneParameter(1, kLaneLoopPoint), 5.0f);
+        session.core.activate(kSampleRate);
+
+        const uint32_t framesPerBeat = static_cast<uint32_t>(session.framesPerBeat());
+        for (int32_t beat = 0; beat < 16; beat++)
+        {
+            session.run(framesPerBeat);
+            CHECK(session.step(0) == beat % 3);
+            CHECK(session.step(1) == beat % 5);
+        }
+    }
+
+    // MIDI notes, looping every 2 steps, and the loop point moved below the current step
+    {
+        Session session;
+        session.core.setParameterValue(kParameterMeasure, kStepMidiNote);
+        session.core.setParameterValue(kParameterLoopPoint, 2.0f);
+        session.core.activate(kSampleRate);
+
+        const std::vector<ScaleSequencePlusMidiEvent> note = { { 0, 3, { 0x90, 60, 100, 0 }, nullptr } };
+        for (int32_t n = 0; n < 5; n++)
+        {
+            session.run(256, note);
+            CHECK(session.step() == n % 2);
+        }
+
+        session.core.setParameterValue(kParameterLoopPoint, 8.0f);
+        for (int32_t n = 0; n < 6; n++)
+            session.run(256, note);
+        CHECK(session.step() == 6);
+
+        session.core.setParameterValue(kParameterLoopPoint, 4.0f);
+        session.run(256, note);
+        CHECK(session.step() == 0);
+    }
+}
+
+static void testScaleSwitch()
+{
+    // Scale 1 (12 EDO) and 2 (19 EDO) taking turns every beat, with the shortest glide, which arrives within a beat
+    Session session;
+    session.core.setParameterValue(kParameterMeasure, kStepBeats);
+    session.core.setParameterValue(kParameterLoopPoint, 2.0f);
+    session.core.setParameterValue(kParameterStep1, 1.0f);
+    session.core.setParameterValue(kParameterStep2, 2.0f);
+    session.core.setParameterValue(kParameterScaleGlide, 1.0f);
+    session.core.activate(kSampleRate);
+
+    const std::vector<double> scale1(scaleTable(1));
+    const std::vector<double> scale2(scaleTable(2));
+    const uint32_t blockSize = 256;
+    const uint64_t beat = static_cast<uint64_t>(session.framesPerBeat());
+
+    // The first scale is taken straight away, without a glide
+    session.run(blockSize);
+    CHECK(tableDistance(session.sink.getTable(), scale1) < kToleranceInCents);
+    CHECK(session.sink.getCounts().scaleNames == 1);
+
+    // Up to the block the next beat starts in
+    while (session.frame() + blockSize <= beat)
+        session.run(blockSize);
+    CHECK(tableDistance(session.sink.getTable(), scale1) < kToleranceInCents);
+
+    // The glide starts on the frame of the beat: the rest of the block is that many frames of it
+    const uint32_t glideFrames = static_cast<uint32_t>(session.frame() + blockSize - beat);
+    CHECK(glideFrames > 0 && glideFrames < blockSize);
+    session.run(blockSize);
+
+    std::vector<double> expected(scale1);
+    for (int32_t i = 0; i < 128; i++)
+        expected[i] = scale2[i] + (scale1[i] - scale2[i]) * glideRemaining(1.0f, glideFrames);
+    CHECK(tableDistance(session.sink.getTable(), expected) < kToleranceInCents);
+    CHECK(session.sink.getCounts().scaleNames == 2);
+
+    // It arrives before the beat after
+    while (session.frame() + blockSize <= 2 * beat)
+        session.run(blockSize);
+    CHECK(tableDistance(session.sink.getTable(), scale2) == 0.0);
+
+    // And back
+    while (session.frame() + blockSize <= 3 * beat)
+        session.run(blockSize);
+    CHECK(tableDistance(session.sink.getTable(), scale1) == 0.0);
+    CHECK(session.sink.getCounts().scaleNames == 3);
+}
+
+static void testGlide()
+{
+    // Scale 1 (12 EDO) for the first bar, scale 4 (31 EDO) from the second, with a long glide. At 30 bpm a bar is
+    // 8 seconds, more than the glide takes.
+    Session session(30.0);
+    session.core.setParameterValue(kParameterMeasure, kStepBars);
+    session.core.setParameterValue(kParameterLoopPoint, 2.0f);
+    session.core.setParameterValue(kParameterStep1, 1.0f);
+    session.core.setParameterValue(kParameterStep2, 4.0f);
+    session.core.setParameterValue(kParameterScaleGlide, 10.0f);
+    session.core.activate(kSampleRate);
+
+    const std::vector<double> origin(scaleTable(1));
+    const std::vector<double> target(scaleTable(4));
+    const uint32_t blockSize = 512;
+    const uint64_t bar = static_cast<uint64_t>(4 * session.framesPerBeat());
+
+    // Start the second bar on a block boundary
+    CHECK(bar % blockSize == 0);
+    while (session.frame() < bar)
+        session.run(blockSize);
+
+    // Every note moves 1/10000 of the way on every frame, until it is within 0.0001 Hz
+    double widest = 0.0;
+    for (int32_t i = 0; i < 128; i++)
+        widest = std::max(widest, std::fabs(target[i] - origin[i]));
+    const uint64_t arrival = static_cast<uint64_t>(std::ceil(std::log(0.0001 / widest) / std::log(1.0 - 1.0 / 10000.0)));
+
+    std::vector<double> previous(origin);
+    uint64_t converged = 0;
+    while (converged == 0 && session.frame() < 2 * bar)
+    {
+        session.run(blockSize);
+        const double* const table = session.sink.getTable();
+
+        // Notes that are left on the curve are where it says; the others have snapped to the target from close by
+        const uint64_t frames = session.frame() - bar;
+        bool arrived = true;
+        for (int32_t i = 0; i < 128; i++)
+        {
+            const double expected = target[i] + (origin[i] - target[i]) * glideRemaining(10.0f, static_cast<uint32_t>(frames));
+            if (table[i] != target[i])
+                CHECK(std::fabs(1200.0 * std::log2(table[i] / expected)) < kToleranceInCents);
+            else
+                CHECK(std::fabs(expected - target[i]) < 0.001);
+
+            CHECK(std::fabs(target[i] - table[i]) <= std::fabs(target[i] - previous[i]));
+            previous[i] = table[i];
+            arrived = arrived && table[i] == target[i];
+        }
+
+        if (arrived)
+            converged = frames;
+    }
+
+    CHECK(converged + blockSize > arrival && converged < arrival + 2 * blockSize);
+
+    // Once it has arrived the table is published once per block
+    const uint32_t tables = session.sink.getCounts().tables;
+    for (int32_t block = 0; block < 10; block++)
+        session.run(blockSize);
+    CHECK(session.sink.getCounts().tables == tables + 10);
+    CHECK(tableDistance(session.sink.getTable(), target) == 0.0);
+}
+
+/**
+   Checks every table the core publishes against the double-precision glide, one frame per table: each note moves
+   1/(glide * 1000) of the way to its target, or snaps to it from within 0.0001 Hz. Switching scales is followed
+   from the scale names; the first scale is taken straight away.
+ */
+class GlideCheckSink final : public TuningSink
+{
+public:
+    explicit GlideCheckSink(float glide)
+        : fDivisor(glide * 1000.0),
+          fSnap(true),
+          fTables(0),
+          fWorst(0.0)
+    {
+        for (int32_t slot = 1; slot <= 8; slot++)
+            fScaleTables[slot - 1] = scaleTable(slot);
+    }
+
+    uint32_t getTables() const { return fTables; }
+    double getWorstInCents() const { return fWorst; }
+
+    bool registerMaster(const void*) override { return true; }
+    void deregisterMaster() override {}
+
+    void setScaleName(const char* name) override
+    {
+        // Each scale is named after its number of notes
+        const int32_t notes = std::atoi(name);
+        for (int32_t slot = 1; slot <= 8; slot++)
+        {
+            if (kEdos[slot - 1] == notes)
+                fTargets = fScaleTables[slot - 1];
+        }
+        if (fSnap)
+            fExpected = fTargets;
+        fSnap = false;
+    }
+
+    void setNoteTunings(const double freqs[128]) override
+    {
+        if (fExpected.empty())
+            return;
+
+        if (fTables > 0)
+        {
+            for (int32_t i = 0; i < 128; i++)
+            {
+                const double difference = fTargets[i] - fExpected[i];
+                if (std::fabs(difference) < 0.0001f)
+                    fExpected[i] = fTargets[i];
+                else
+                    fExpected[i] += difference / fDivisor;
+            }
+        }
+        fTables++;
+
+        fWorst = std::max(fWorst, tableDistance(freqs, fExpected));
+    }
+
+    void filterNote(bool, char, char) override {}
+    void clearNoteFilter() override {}
+    void setMultiChannel(bool, char) override {}
+    void setMultiChannelNoteTunings(const double[128], char) override {}
+
+private:
+    const double fDivisor;
+    std::vector<double> fScaleTables[8];
+    std::vector<double> fTargets;
+    std::vector<double> fExpected;
+    bool fSnap;
+    uint32_t fTables;
+    double fWorst;
+};
+
+static void testGlideAccuracy()
+{
+    // A step every second through the eight scales and back to the first. The short glides arrive within a step,
+    // the long ones are switched away from halfway.
+    for (const float glide : { 1.0f, 1.5f, 2.0f, 5.0f, 10.0f, 20.0f, 50.0f, 100.0f })
+    {
+        Session session(60.0);
+        GlideCheckSink sink(glide);
+        session.core.setTuningSink(&sink);
+        for (int32_t step = 0; step < 8; step++)
+            session.core.setParameterValue(kParameterStep1 + step, static_cast<float>(1 + step));
+        session.core.setParameterValue(kParameterLoopPoint, 8.0f);
+        session.core.setParameterValue(kParameterMeasure, kStepBeats);
+        session.core.setParameterValue(kParameterScaleGlide, glide);
+        session.core.activate(kSampleRate);
+
+        const uint64_t end = static_cast<uint64_t>(9 * session.framesPerBeat());
+        while (session.frame() < end)
+            session.run(256);
+
+        std::printf("glide %5.1f: %u tables, at most %.2g cents from the double-precision glide\n",
+                    glide, sink.getTables(), sink.getWorstInCents());
+        CHECK(sink.getTables() > 8 * 1000);
+        CHECK(sink.getWorstInCents() < kToleranceInCents);
+
+        // Before the sink goes
+        session.core.deactivate();
+    }
+}
+
+static void testOfflineGlide()
+{
+    // Four scales taking turns every beat, with a glide that takes most of a beat, played into a core gliding frame by
+    // frame and one gliding in closed form. Both publish once per block at least, and at its end the tables agree.
+    // Notes within 0.0001 Hz of their target snap to it a frame earlier or later, which is at most 0.02 cents at the
+    // bottom of the range.
+    Session perFrame;
+    Session offline;
+    for (Session* session : { &perFrame, &offline })
+    {
+        session->core.setParameterValue(kParameterMeasure, kStepBeats);
+        session->core.setParameterValue(kParameterLoopPoint, 4.0f);
+        session->core.setParameterValue(kParameterStep1, 1.0f);
+        session->core.setParameterValue(kParameterStep2, 4.0f);
+        session->core.setParameterValue(kParameterStep3, 2.0f);
+        session->core.setParameterValue(kParameterStep4, 8.0f);
+        session->core.setParameterValue(kParameterScaleGlide, 5.0f);
+    }
+    offline.core.setOfflineGlide(true);
+    perFrame.core.activate(kSampleRate);
+    offline.core.activate(kSampleRate);
+
+    const uint32_t blockSize = 512;
+    double widest = 0.0;
+    while (perFrame.frame() < static_cast<uint64_t>(8 * perFrame.framesPerBeat()))
+    {
+        perFrame.run(blockSize);
+        offline.run(blockSize);
+
+        const double* const expected = perFrame.sink.getTable();
+        widest = std::max(widest, tableDistance(offline.sink.getTable(), std::vector<double>(expected, expected + 128)));
+    }
+    CHECK(offline.step() == perFrame.step() && offline.step() == 3);
+    CHECK(widest < 0.05);
+
+    // Far fewer tables were published
+    CHECK(offline.sink.getCounts().tables * 50 < perFrame.sink.getCounts().tables);
+}
+
+static void testReload()
+{
+    Session session;
+    for (int32_t step = 0; step < kNumSteps; step++)
+        session.core.setParameterValue(kParameterStep1 + step, 1.0f);
+    session.core.setParameterValue(kParameterMeasure, kStepBeats);
+    session.core.setParameterValue(kParameterScaleGlide, 1.0f);
+    session.core.activate(kSampleRate);
+    session.run(256);
+    CHECK(tableDistance(session.sink.getTable(), scaleTable(1)) < kToleranceInCents);
+
+    // Slot 1 keeps being reloaded, the way a host restoring state does, while the core plays on it
+    std::atomic<bool> loaded(false);
+    std::thread loader([&] {
+        for (int32_t i = 0; i < 50; i++)
+            session.core.loadScl(1, scalePath(i % 2 == 0 ? 2 : 3).string().c_str());
+        session.core.loadScl(1, scalePath(4).string().c_str());
+        loaded = true;
+    });
+    while (!loaded)
+        session.run(256);
+    loader.join();
+
+    // And ends up on the last file loaded
+    const uint64_t end = session.frame() + static_cast<uint64_t>(session.framesPerBeat());
+    while (session.frame() < end)
+        session.run(256);
+    CHECK(tableDistance(session.sink.getTable(), scaleTable(4)) < kToleranceInCents);
+    CHECK(std::strstr(session.sink.getScaleName(), "31") != nullptr);
+}
+
+/**
+   The frequency of MIDI note @a semitones, fractions of a semitone included.
+ */
+static double semitonesInHz(double semitones)
+{
+    return 440.0 * std::exp2((semitones - 69.0) / 12.0);
+}
+
+static bool encodesAs(double hz, uint8_t note, uint8_t msb, uint8_t lsb)
+{
+    uint8_t words[3];
+    encodeMtsFrequency(hz, words);
+    return words[0] == note && words[1] == msb && words[2] == lsb;
+}
+
+static void testMtsEncoding()
+{
+    CHECK(encodesAs(440.0, 69, 0x00, 0x00));
+    CHECK(encodesAs(semitonesInHz(60.5), 60, 0x40, 0x00));
+    CHECK(encodesAs(semitonesInHz(126.0 + 16383.0 / 16384.0), 126, 0x7F, 0x7F));
+
+    // 7F 7F 7F means "no change", so the top of the range stops one step short of it
+    CHECK(encodesAs(semitonesInHz(127.0), 127, 0x00, 0x00));
+    CHECK(encodesAs(semitonesInHz(127.0 + 16382.0 / 16384.0), 127, 0x7F, 0x7E));
+    CHECK(encodesAs(semitonesInHz(127.0 + 16383.0 / 16384.0), 127, 0x7F, 0x7E));
+    CHECK(encodesAs(semitonesInHz(127.0 + 16383.6 / 16384.0), 127, 0x7F, 0x7E));
+    CHECK(encodesAs(semitonesInHz(130.0), 127, 0x7F, 0x7E));
+
+    // And the bottom is note 0
+    CHECK(encodesAs(1.0, 0, 0x00, 0x00));
+    CHECK(encodesAs(std::nan(""), 0, 0x00, 0x00));
+}
+
+static void testNotMaster()
+{
+    // Another master has the sink, so the core only sends its tuning over SysEx, as fast as it can
+    Session session;
+    int32_t otherMaster = 0;
+    session.sink.registerMaster(&otherMaster);
+
+    session.core.setParameterValue(kParameterMeasure, kStepBeats);
+    session.core.setParameterValue(kParameterLoopPoint, 2.0f);
+    session.core.setParameterValue(kParameterStep1, 1.0f);
+    session.core.setParameterValue(kParameterStep2, 2.0f);
+    session.core.setParameterValue(kParameterMultiChannel, 1.0f);
+    session.core.setParameterValue(kParameterChannel1, 3.0f);
+    session.core.setParameterValue(kParameterSysExMode, kSysExSingleNote);
+    session.core.setParameterValue(kParameterSysExDinRate, 0.0f);
+    session.core.activate(kSampleRate);
+
+    uint8_t scale1[128][3];
+    uint8_t scale2[128][3];
+    for (int32_t i = 0; i < 128; i++)
+    {
+        encodeMtsFrequency(scaleTable(1)[i], scale1[i]);
+        encodeMtsFrequency(scaleTable(2)[i], scale2[i]);
+    }
+
+    const uint32_t blockSize = 256;
+    const uint64_t beat = static_cast<uint64_t>(session.framesPerBeat());
+
+    while (session.frame() + blockSize <= beat)
+        session.run(blockSize);
+    CHECK(session.step() == 0);
+    CHECK(std::memcmp(session.host.sysExWords, scale1, sizeof(scale1)) == 0);
+
+    // The glide to the second scale goes out as it happens, and arrives
+    const uint32_t messages = session.host.sysExMessages;
+    while (session.frame() + blockSize <= 2 * beat)
+        session.run(blockSize);
+    CHECK(session.step() == 1);
+    CHECK(session.host.sysExMessages > messages + 10);
+    CHECK(std::memcmp(session.host.sysExWords, scale2, sizeof(scale2)) == 0);
+
+    // Nothing was published to MTS-ESP
+    const RecordingTuningSink::Counts& counts(session.sink.getCounts());
+    CHECK(session.core.getParameterValue(kParameterMasterStatus) == 0.0f);
+    CHECK(counts.tables == 0 && counts.channelTables == 0 && counts.scaleNames == 0);
+    CHECK(counts.filterChanges == 0 && counts.filterClears == 0 && counts.multiChannelChanges == 0);
+}
+
+static void testSwitchFrame()
+{
+    // Scale 1 for the first beat and scale 2 from the second, sent over SysEx and MPE
+    Session session;
+    session.core.setParameterValue(kParameterMeasure, kStepBeats);
+    session.core.setParameterValue(kParameterLoopPoint, 2.0f);
+    session.core.setParameterValue(kParameterStep1, 1.0f);
+    session.core.setParameterValue(kParameterStep2, 2.0f);
+    session.core.setParameterValue(kParameterSysExMode, kSysExSingleNote);
+    session.core.setParameterValue(kParameterSysExDinRate, 0.0f);
+    session.core.setParameterValue(kParameterMpeOutput, 1.0f);
+    session.core.activate(kSampleRate);
+
+    const uint32_t blockSize = 256;
+    const uint64_t beat = static_cast<uint64_t>(session.framesPerBeat());
+
+    // A note playing on a member channel of its own
+    session.run(blockSize, { { 0, 3, { 0x90, 64, 100, 0 }, nullptr } });
+    uint8_t member = 0;
+    for (const ScaleSequencePlusMidiEvent& event : session.host.midiOut)
+    {
+        if ((event.data[0] & 0xF0) == 0x90)
+            member = event.data[0] & 0x0F;
+    }
+    CHECK(member != 0);
+
+    while (session.frame() + blockSize <= beat)
+        session.run(blockSize);
+
+    // The block the second beat starts in, with MIDI before and after its frame
+    const uint32_t switchFrame = static_cast<uint32_t>(beat - session.frame());
+    CHECK(switchFrame > 0 && switchFrame < blockSize - 1);
+    session.host.midiOut.clear();
+    session.run(blockSize, { { 0, 3, { 0xB0, 1, 10, 0 }, nullptr }, { blockSize - 1, 3, { 0xB0, 1, 20, 0 }, nullptr } });
+
+    bool sysEx = false;
+    bool bend = false;
+    uint32_t previous = 0;
+    for (const ScaleSequencePlusMidiEvent& event : session.host.midiOut)
+    {
+        CHECK(event.frame >= previous);
+        previous = event.frame;
+
+        if (event.size > ScaleSequencePlusMidiEvent::kDataSize)
+        {
+            CHECK(event.frame == switchFrame);
+            sysEx = true;
+        }
+        else if (event.data[0] == (0xE0 | member))
+        {
+            CHECK(event.frame == switchFrame);
+            bend = true;
+        }
+    }
+    CHECK(sysEx && bend);
+    CHECK(session.host.midiOut.front().frame == 0 && session.host.midiOut.back().frame == blockSize - 1);
+}
+
+static void testDinRate()
+{
+    // Gliding between two scales every beat, over SysEx limited to the DIN rate, while MPE bends follow two notes
+    Session session;
+    session.core.setParameterValue(kParameterMeasure, kStepBeats);
+    session.core.setParameterValue(kParameterLoopPoint, 2.0f);
+    session.core.setParameterValue(kParameterStep1, 1.0f);
+    session.core.setParameterValue(kParameterStep2, 4.0f);
+    session.core.setParameterValue(kParameterScaleGlide, 5.0f);
+    session.core.setParameterValue(kParameterSysExMode, kSysExSingleNote);
+    session.core.setParameterValue(kParameterSysExDinRate, 1.0f);
+    session.core.setParameterValue(kParameterMpeOutput, 1.0f);
+    session.core.activate(kSampleRate);
+
+    const uint32_t blockSize = 256;
+    session.run(blockSize, { { 0, 3, { 0x90, 61, 100, 0 }, nullptr }, { 0, 3, { 0x90, 66, 100, 0 }, nullptr } });
+    while (session.frame() < 4 * kSampleRate)
+        session.run(blockSize);
+
+    // Every byte written counts, so over the whole run they stay within the rate, and what it lets save up
+    double bytes = 0.0;
+    double bendBytes = 0.0;
+    for (const ScaleSequencePlusMidiEvent& event : session.host.midiOut)
+    {
+        bytes += event.size;
+        if ((event.data[0] & 0xF0) == 0xE0)
+            bendBytes += event.size;
+    }
+    const double seconds = session.frame() / kSampleRate;
+    CHECK(bytes <= seconds * kMidiDinBytesPerSecond + kMtsBulkDumpSize);
+    CHECK(bendBytes > 0.1 * seconds * kMidiDinBytesPerSecond);
+    CHECK(session.host.sysExMessages > 100);
+}
+
+static void testMpeNoteOff()
+{
+    Session session;
+    session.core.setParameterValue(kParameterMpeOutput, 1.0f);
+    session.core.activate(kSampleRate);
+    session.run(256, { { 0, 3, { 0x92, 60, 100, 0 }, nullptr } });
+
+    // Notes started before the output was on, one of them with a note on of velocity 0
+    const std::vector<ScaleSequencePlusMidiEvent> events = {
+        { 4, 3, { 0x82, 62, 30, 0 }, nullptr },
+        { 8, 3, { 0x95, 60, 0, 0 }, nullptr },
+    };
+    session.host.midiOut.clear();
+    session.run(256, events);
+
+    CHECK(session.host.midiOut.size() == events.size());
+    for (std::size_t i = 0; i < events.size() && i < session.host.midiOut.size(); i++)
+    {
+        const ScaleSequencePlusMidiEvent& event(session.host.midiOut[i]);
+        CHECK(event.frame == events[i].frame && event.size == events[i].size && std::memcmp(event.data, events[i].data, 3) == 0);
+    }
+
+    // The note that is playing is stopped on its member channel
+    session.host.midiOut.clear();
+    session.run(256, { { 0, 3, { 0x82, 60, 0, 0 }, nullptr } });
+    CHECK(session.host.midiOut.size() == 1);
+    CHECK(!session.host.midiOut.empty() && (session.host.midiOut[0].data[0] & 0xF0) == 0x80
+          && (session.host.midiOut[0].data[0] & 0x0F) != 2 && session.host.midiOut[0].data[1] == 60);
+}
+
+static void testBypass()
+{
+    Session session;
+    session.core.setParameterValue(kParameterMpeOutput, 1.0f);
+    session.core.activate(kSampleRate);
+
+    // A note on goes out on a member channel of its own
+    session.run(256, { { 0, 3, { 0x90, 60, 100, 0 }, nullptr } });
+    CHECK(!session.host.midiOut.empty() && session.host.midiOut.back().data[0] != 0x90);
+    const uint32_t tables = session.sink.getCounts().tables;
+
+    // Bypassed, the note is stopped on its member channel, then everything goes out as it came in
+    const std::vector<ScaleSequencePlusMidiEvent> events = {
+        { 3, 3, { 0x80, 60, 0, 0 }, nullptr },
+        { 5, 3, { 0x91, 62, 90, 0 }, nullptr },
+        { 7, 3, { 0xE1, 0, 0x50, 0 }, nullptr },
+        { 9, 3, { 0xA1, 62, 20, 0 }, nullptr },
+    };
+    session.core.setParameterValue(kParameterBypass, 1.0f);
+    session.host.midiOut.clear();
+    session.run(256, events);
+
+    CHECK(session.host.midiOut.size() > events.size());
+    const ScaleSequencePlusMidiEvent* const passed = session.host.midiOut.data() + session.host.midiOut.size() - events.size();
+    for (std::size_t i = 0; i < events.size(); i++)
+        CHECK(passed[i].frame == events[i].frame && passed[i].size == events[i].size && std::memcmp(passed[i].data, events[i].data, 3) == 0);
+
+    bool stopped = false;
+    for (const ScaleSequencePlusMidiEvent& event : session.host.midiOut)
+        stopped = stopped || ((event.data[0] & 0xF0) == 0x80 && (event.data[0] & 0x0F) != 0 && event.data[1] == 60);
+    CHECK(stopped);
+
+    // And nothing more is published
+    session.host.midiOut.clear();
+    session.run(256, events);
+    CHECK(session.host.midiOut.size() == events.size());
+    CHECK(session.sink.getCounts().tables <= tables + 1);
+}
+
+static void testHandover()
+{
+    // Two cores in one process, publishing to the same sink; the first one activated is the master
+    Session first;
+    Session second;
+    second.core.setTuningSink(&first.sink);
+    second.core.setParameterValue(kParameterLoopPoint, 2.0f);
+    second.core.setParameterValue(kParameterStep2, 2.0f);
+    first.core.activate(kSampleRate);
+    second.core.activate(kSampleRate);
+    first.run(256);
+    second.run(256);
+    CHECK(first.core.getParameterValue(kParameterMasterStatus) == 1.0f);
+    CHECK(second.core.getParameterValue(kParameterMasterStatus) == 0.0f);
+
+    // The second one follows its sequence on to the second scale, without gliding to it
+    while (second.frame() <= static_cast<uint64_t>(second.framesPerBeat()))
+        second.run(256);
+    CHECK(second.step() == 1);
+
+    // Bypassed, the first one hands back in its next block, and the master thread lets the second one take over
+    first.core.setParameterValue(kParameterBypass, 1.0f);
+    first.run(256);
+    CHECK(first.core.getParameterValue(kParameterMasterStatus) == 0.0f);
+
+    const auto start = std::chrono::steady_clock::now();
+    while (second.core.getParameterValue(kParameterMasterStatus) == 0.0f
+           && std::chrono::steady_clock::now() - start < std::chrono::seconds(2))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        second.run(256);
+    }
+    CHECK(second.core.getParameterValue(kParameterMasterStatus) == 1.0f);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+
+    // And publishes from then on, starting on the second scale
+    const uint32_t tables = first.sink.getCounts().tables;
+    second.run(256);
+    CHECK(first.sink.getCounts().tables > tables);
+    CHECK(tableDistance(first.sink.getTable(), scaleTable(2)) < kToleranceInCents);
+
+    // Back from bypass, the first one stays in the background
+    first.core.setParameterValue(kParameterBypass, 0.0f);
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    first.run(256);
+    CHECK(first.core.getParameterValue(kParameterMasterStatus) == 0.0f);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct Test
+{
+    const char* name;
+    void (*run)();
+};
+
+static const Test kTests[] = {
+    { "beats",        testBeats },
+    { "bars",         testBars },
+    { "note",         testNote },
+    { "loop-points",  testLoopPoints },
+    { "scale-switch", testScaleSwitch },
+    { "glide",        testGlide },
+    { "glide-accuracy", testGlideAccuracy },
+    { "offline-glide", testOfflineGlide },
+    { "reload",       testReload },
+    { "mts-encoding", testMtsEncoding },
+    { "not-master",   testNotMaster },
+    { "switch-frame", testSwitchFrame },
+    { "din-rate",     testDinRate },
+    { "mpe-note-off", testMpeNoteOff },
+    { "bypass",       testBypass },
+    { "handover",     testHandover },
+};
+
+static bool runTest(const Test& test)
+{
+    // Each test has scale files of its own, so CTest can run them side by side
+    gScaleDir = fs::temp_directory_path() / "scalesequence-core-tests" / test.name;
+    if (!writeScales(gScaleDir))
+    {
+        std::fprintf(stderr, "%s: could not write the scales to %s\n", test.name, gScaleDir.string().c_str());
+        return false;
+    }
+
+    const uint32_t failuresBefore = gFailures;
+    test.run();
+    std::printf("%-14s %s\n", test.name, gFailures == failuresBefore ? "passed" : "FAILED");
+    return gFailures == failuresBefore;
+}
+
+int main(int argc, char* argv[])
+{
+    bool passed = true;
+
+    if (argc < 2)
+    {
+        for (const Test& test : kTests)
+            passed = runTest(test) && passed;
+        return passed ? 0 : 1;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        const Test* found = nullptr;
+        for (const Test& test : kTests)
+            if (std::string(argv[i]) == test.name)
+                found = &test;
+
+        if (found == nullptr)
+        {
+            std::fprintf(stderr, "Unknown test: %s\n", argv[i]);
+            return 1;
+        }
+        passed = runTest(*found) && passed;
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/*
+ * Integration test of the shared-memory sink (ScaleSequencePlusShmSink.hpp), run by CTest.
+ *
+ * A core publishes to a ShmTuningSink, with scale slot 1 loaded with 19 EDO and channel 3 following slot 2, 31 EDO.
+ * The test then starts itself again as a client, in a process of its own, which reads the block with
+ * ShmTuningClient like an MTS-ESP client would read libMTS, and checks the master, the scale name, the global table
+ * and the channel table. Once the core is deactivated, a second client checks that the master is gone.
+ *
+ * Usage: scalesequence-shm-sink-tests
+ * The exit code is 1 if any check failed, in either process.
+ */
+
+#include "ScaleSequencePlusCore.hpp"
+#include "ScaleSequencePlusShmSink.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+static const double kSampleRate = 48000.0;
+
+static uint32_t gFailures = 0;
+
+static void check(bool condition, const char* text, const char* file, int line)
+{
+    if (condition)
+        return;
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+    gFailures++;
+}
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static fs::path scalePath(const fs::path& dir, int32_t edo)
+{
+    return dir / (std::to_string(edo) + "edo.scl");
+}
+
+static bool writeScale(const fs::path& dir, int32_t edo)
+{
+    std::ofstream file(scalePath(dir, edo));
+    file << "! " << edo << "edo.scl\n" << edo << " equal divisions of the octave\n " << edo << "\n!\n";
+    for (int32_t i = 1; i <= edo; i++)
+        file << " " << (1200.0 * i / edo) << "\n";
+    return static_cast<bool>(file);
+}
+
+/**
+   Whether @a published is the table of the scale in @a path, to within a millionth of a cent.
+ */
+static bool isScale(const double* published, const fs::path& path)
+{
+    const Tunings::Tuning tuning(Tunings::readSCLFile(path.string()));
+    for (int32_t i = 0; i < 128; i++)
+    {
+        if (!(std::fabs(1200.0 * std::log2(published[i] / tuning.frequencyForMidiNote(i))) < 1e-6))
+            return false;
+    }
+    return true;
+}
+
+class TestHost : public ScaleSequencePlusHost
+{
+public:
+    void sendMidiEvent(const ScaleSequencePlusMidiEvent&) override
+    {
+    }
+
+    void tuningFileInfoChanged(States, const TuningFileInfo&) override
+    {
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+/**
+   The client process: what is in the block called @a name, published by the core from the scales in @a dir.
+ */
+static int runClient(const char* name, const fs::path& dir, bool expectMaster)
+{
+    ShmTuningClient client;
+    CHECK(client.open(name));
+    CHECK(client.hasMaster() == expectMaster);
+
+    if (expectMaster)
+    {
+        static ShmTuningState state;
+        CHECK(client.read(state));
+        CHECK(std::strstr(state.scaleName, "19") != nullptr);
+        CHECK(isScale(state.table, scalePath(dir, 19)));
+        CHECK(state.multiChannel == 1u << 2);
+        CHECK(isScale(state.channelTables[2], scalePath(dir, 31)));
+    }
+
+    return gFailures == 0 ? 0 : 1;
+}
+
+/**
+   Start this executable again as a client, and return its exit code.
+ */
+static int startClient(const char* self, const std::string& name, const fs::path& dir, bool expectMaster)
+{
+    const std::string command = "\"" + std::string(self) + "\" --client " + name + " \"" + dir.string() + "\" "
+                              + (expectMaster ? "master" : "none");
+    return std::system(command.c_str());
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 5 && std::string(argv[1]) == "--client")
+        return runClient(argv[2], argv[3], std::string(argv[4]) == "master");
+
+    const fs::path dir = fs::temp_directory_path() / "scalesequence-shm-sink-tests";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (!writeScale(dir, 19) || !writeScale(dir, 31))
+    {
+        std::fprintf(stderr, "Could not write the scales to %s\n", dir.string().c_str());
+        return 1;
+    }
+
+    // A name of its own for every run, so runs side by side don't meet
+    const std::string name = "/scalesequence-shm-test-"
+                           + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count() % 1000000007);
+    ShmTuningMapping::unlink(name.c_str());
+
+    {
+        ShmTuningSink sink(name.c_str());
+        CHECK(sink.isOpen());
+
+        TestHost host;
+        ScaleSequencePlusCore core(host);
+        core.setTuningSink(&sink);
+        core.loadScl(1, scalePath(dir, 19).string().c_str());
+        core.loadScl(2, scalePath(dir, 31).string().c_str());
+        core.setParameterValue(kParameterScaleGlide, 1.0f);
+        core.setParameterValue(kParameterMultiChannel, 1.0f);
+        core.setParameterValue(kParameterChannel1 + 2, 2.0f);
+        core.activate(kSampleRate);
+
+        // Two seconds at 120 bpm, long enough for the channel table to glide all the way to its scale
+        const uint32_t blockSize = 512;
+        ScaleSequencePlusTransport transport = {};
+        transport.playing = true;
+        transport.bbt.valid = true;
+        transport.bbt.ticksPerBeat = 1920.0;
+        transport.bbt.beatsPerBar = 4.0f;
+        transport.bbt.beatsPerMinute = 120.0;
+        for (uint64_t frame = 0; frame < static_cast<uint64_t>(2 * kSampleRate); frame += blockSize)
+        {
+            const double beats = frame / (kSampleRate / 2.0);
+            const int64_t wholeBeats = static_cast<int64_t>(beats);
+            transport.frame = frame;
+            transport.bbt.bar = static_cast<int32_t>(wholeBeats / 4) + 1;
+            transport.bbt.beat = static_cast<int32_t>(wholeBeats % 4) + 1;
+            transport.bbt.tick = (beats - wholeBeats) * transport.bbt.ticksPerBeat;
+            core.run(blockSize, transport, nullptr, 0);
+        }
+        CHECK(core.getParameterValue(kParameterMasterStatus) == 1.0f);
+
+        CHECK(startClient(argv[0], name, dir, true) == 0);
+
+        // Before the sink goes
+        core.deactivate();
+        CHECK(startClient(argv[0], name, dir, false) == 0);
+    }
+
+    ShmTuningMapping::unlink(name.c_str());
+
+    std::printf("shm-sink %s\n", gFailures == 0 ? "passed" : "FAILED");
+    return gFailures == 0 ? 0 : 1;
+}
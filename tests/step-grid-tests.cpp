@@ -0,0 +1,243 @@
+/*
+ * Allocation test of the step grid (ScaleSequencePlusStepGrid.hpp), run by CTest.
+ *
+ * Every open editor draws the grid on every frame. This draws it with Dear ImGui and no renderer backend, with the
+ * global operator new and ImGui's allocator replaced by counting ones, and checks that once ImGui has been through
+ * a few frames with it, drawing the grid allocates nothing: with lane 1's labels and the other lanes', with the
+ * current step moving on every frame, and with a step being clicked.
+ *
+ * Usage: scalesequence-step-grid-tests
+ * The exit code is 1 if anything was allocated.
+ */
+
+#include "imgui.h"
+#include "ScaleSequencePlusStepGrid.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static bool gCounting = false;
+static uint64_t gAllocations = 0;
+static uint32_t gFailures = 0;
+
+static void check(bool condition, const char* text, const char* file, int line)
+{
+    if (condition)
+        return;
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+    gFailures++;
+}
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+// --------------------------------------------------------------------------------------------------------------------
+
+void* operator new(std::size_t size)
+{
+    if (gCounting)
+        gAllocations++;
+    if (void* const memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+// ImGui allocates with malloc() unless told otherwise
+static void* countingAlloc(size_t size, void*)
+{
+    if (gCounting)
+        gAllocations++;
+    return std::malloc(size);
+}
+
+static void countingFree(void* memory, void*)
+{
+    std::free(memory);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+/**
+   Keeps the last step set, like the UI keeps its parameters.
+ */
+class TestEditor : public StepGridEditor
+{
+public:
+    uint32_t edits = 0;
+    uint32_t sets = 0;
+    uint32_t lastIndex = 0;
+    float lastValue = -1.0f;
+
+    void editStep(uint32_t, bool) override
+    {
+        edits++;
+    }
+
+    void setStep(uint32_t index, float value) override
+    {
+        sets++;
+        lastIndex = index;
+        lastValue = value;
+    }
+};
+
+/**
+   One frame with the grid of @a lane in a window of its own, the way the sequence pane draws it. Returns the
+   allocations made while drawing the grid, and where the last step's button is.
+ */
+static uint64_t drawFrame(float parameters[kParameterCount], int32_t lane, StepGridEditor& editor, ImVec2& lastButton)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1400.0f, 200.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+    ImGui::SetNextWindowSize(io.DisplaySize);
+    ImGui::Begin("sequence pane", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
+
+    const uint64_t before = gAllocations;
+    gCounting = true;
+    drawStepGrid(parameters, lane, ImVec2(32.0f, 32.0f), ImVec4(0.95f, 0.33f, 0.14f, 0.47f), editor);
+    gCounting = false;
+    const uint64_t allocations = gAllocations - before;
+
+    const ImVec2 min = ImGui::GetItemRectMin();
+    const ImVec2 max = ImGui::GetItemRectMax();
+    lastButton = ImVec2((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f);
+
+    ImGui::End();
+    ImGui::Render();
+
+    return allocations;
+}
+
+/**
+   Mouse input, through the input events of Dear ImGui 1.87 and later, or the input state of the versions before.
+ */
+static void moveMouse(const ImVec2& position)
+{
+#if IMGUI_VERSION_NUM >= 18700
+    ImGui::GetIO().AddMousePosEvent(position.x, position.y);
+#else
+    ImGui::GetIO().MousePos = position;
+#endif
+}
+
+static void pressMouse(bool down)
+{
+#if IMGUI_VERSION_NUM >= 18700
+    ImGui::GetIO().AddMouseButtonEvent(0, down);
+#else
+    ImGui::GetIO().MouseDown[0] = down;
+#endif
+}
+
+/**
+   Click the last step of @a lane: the mouse moves over it, is pressed on one frame and released on the next.
+ */
+static uint64_t clickLastStep(float parameters[kParameterCount], int32_t lane, StepGridEditor& editor, ImVec2& lastButton)
+{
+    uint64_t allocations = 0;
+
+    moveMouse(lastButton);
+    allocations += drawFrame(parameters, lane, editor, lastButton);
+    pressMouse(true);
+    allocations += drawFrame(parameters, lane, editor, lastButton);
+    pressMouse(false);
+    allocations += drawFrame(parameters, lane, editor, lastButton);
+    allocations += drawFrame(parameters, lane, editor, lastButton);
+
+    return allocations;
+}
+
+int main()
+{
+    // The counter counts
+    gCounting = true;
+    int* volatile probe = new int(0);
+    gCounting = false;
+    delete probe;
+    CHECK(gAllocations == 1);
+
+    IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(countingAlloc, countingFree);
+    ImGui::CreateContext();
+
+    // No renderer: the font atlas is built, and never uploaded
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    // Lane 1 has a scale on every step, lane 2 leaves some off
+    float parameters[kParameterCount] = {};
+    for (int32_t step = 0; step < kNumSteps; step++)
+    {
+        parameters[laneParameter(0, kLaneStep1 + step)] = static_cast<float>(1 + step % 8);
+        parameters[laneParameter(1, kLaneStep1 + step)] = static_cast<float>(step % 9);
+    }
+
+    TestEditor editor;
+    ImVec2 lastButton;
+
+    // ImGui sets up the window, the button IDs and the input state it keeps in the first frames
+    for (int32_t lane = 0; lane < 2; lane++)
+    {
+        drawFrame(parameters, lane, editor, lastButton);
+        drawFrame(parameters, lane, editor, lastButton);
+        clickLastStep(parameters, lane, editor, lastButton);
+    }
+    CHECK(editor.sets == 2);
+
+    // From then on, nothing, with the current step moving on every frame
+    uint64_t allocations = 0;
+    for (int32_t lane = 0; lane < 2; lane++)
+    {
+        for (int32_t step = 0; step <= kNumSteps; step++)
+        {
+            parameters[laneParameter(lane, kLaneCurrentStep)] = static_cast<float>(step) * 0.03125f;
+            allocations += drawFrame(parameters, lane, editor, lastButton);
+        }
+    }
+
+    // Or a step being clicked
+    const uint32_t lastStep = laneParameter(0, kLaneStep1 + kNumSteps - 1);
+    const float before = parameters[lastStep];
+    allocations += clickLastStep(parameters, 0, editor, lastButton);
+    CHECK(editor.sets == 3 && editor.lastIndex == lastStep);
+    CHECK(editor.lastValue == (before >= 8.0f ? 1.0f : before + 1.0f));
+
+    std::printf("%llu allocations while drawing the step grid\n", static_cast<unsigned long long>(allocations));
+    CHECK(allocations == 0);
+
+    ImGui::DestroyContext();
+
+    return gFailures == 0 ? 0 : 1;
+}
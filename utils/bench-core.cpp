@@ -0,0 +1,381 @@
+/*
+ * Run the sequencer core (the scalesequence-core library the plugin is built on) without a host, through a set
+ * of fixed scenarios, and report how long a block takes. Used as the training run of a profile-guided build
+ * (utils/pgo-build.sh), and to compare builds: --save writes the results, --compare shows the change against
+ * results saved earlier.
+ *
+ * Each scenario plays a 4/4 transport into a fresh core, with the eight scale slots loaded with
+ * equal divisions of the octave (12, 19, 22, 31, 17, 24, 15 and 53 EDO), so every scale switch moves the table:
+ *   beats    120 bpm, a step every beat, short glide
+ *   bars     120 bpm, a step every bar, short glide
+ *   note     120 bpm, MIDI Note step type, a note every eighth, passed through to the output
+ *   glide    480 bpm, a step every beat with the longest glide, so the table is always moving
+ *   sysex    as glide, with Single Note SysEx output
+ *   mpe      as note, with MPE output and the longest glide
+ *
+ * Results are one line per scenario: the mean and fastest time per block, and how many times faster than real
+ * time that is. Each scenario is run --repeat times and the fastest run is kept.
+ *
+ * --instances runs that many cores one after the other for each block, on one thread, like a host with many
+ * instances of the plugin on one core; the times are then for a block of all of them.
+ *
+ * --lanes turns on that many sequencer lanes, all stepping at the scenario's rate with loop points of 32, 7, 5 and 3
+ * steps and a scale on every step, so the top lane switches the scale on each step. Running the scenarios with
+ * 1 to 4 lanes shows what each lane adds to a block.
+ *
+ * Usage: scalesequence-bench-core [--scenario <name>] [--seconds <n>] [--repeat <n>] [--block-size <n>]
+ *                                 [--sample-rate <n>] [--instances <n>] [--lanes <n>] [--save <file>] [--compare <file>]
+ *
+ * The bench links the plugin's own core, so that it measures, and a PGO build is trained on, the code the plugin
+ * runs. That core publishes to MTS-ESP directly; MtsEspTuningSink::setBenchmarking() makes every core the master
+ * without asking libMTS, so each of them does all the tuning work. Without libMTS installed libMTSMaster drops the
+ * tables, and with it installed they go to libMTS, so run it without another MTS-ESP master open. If any core did not
+ * become the master the results measure something else, and the exit status is 2, so that a PGO build can stop there.
+ *
+ * scalesequence-bench-core-float-glide is built from this file too, on a core with SCALESEQUENCE_PLUS_FLOAT_GLIDE on,
+ * so its glide scenario measures the single-precision glide. That core has the pluggable sink, see
+ * ScaleSequencePlusTuningSink.hpp, and publishes to a NullTuningSink each.
+ */
+
+#include "ScaleSequencePlusCore.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Scenario
+{
+    const char* name;
+    double bpm;
+    float measure;      // kParameterMeasure: 0 beats, 1 bars, 2 MIDI note
+    float glide;
+    float sysExMode;
+    float mpeOutput;
+    double notesPerBeat; // note ons sent, 0 for none
+};
+
+static const Scenario kScenarios[] = {
+    { "beats", 120.0, 0.0f, 1.0f,   kSysExOff,        0.0f, 0.0 },
+    { "bars",  120.0, 1.0f, 1.0f,   kSysExOff,        0.0f, 0.0 },
+    { "note",  120.0, 2.0f, 1.0f,   kSysExOff,        0.0f, 2.0 },
+    { "glide", 480.0, 0.0f, 100.0f, kSysExOff,        0.0f, 0.0 },
+    { "sysex", 480.0, 0.0f, 100.0f, kSysExSingleNote, 0.0f, 0.0 },
+    { "mpe",   120.0, 2.0f, 100.0f, kSysExOff,        1.0f, 2.0 },
+};
+
+static const int32_t kEdos[8] = { 12, 19, 22, 31, 17, 24, 15, 53 };
+static const int32_t kLaneLoopPoints[kNumLanes] = { 32, 7, 5, 3 };
+
+struct Result
+{
+    double meanNs;
+    double bestNs;
+    double realtime;
+    uint32_t idleCores; // cores that published no tables
+};
+
+/**
+   Throws the output away, but counts it so the compiler can't.
+ */
+class BenchHost : public ScaleSequencePlusHost
+{
+public:
+    uint64_t midiBytes = 0;
+
+    void sendMidiEvent(const ScaleSequencePlusMidiEvent& event) override
+    {
+        midiBytes += event.size;
+    }
+
+    void tuningFileInfoChanged(States, const TuningFileInfo&) override
+    {
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static bool writeScales(const fs::path& dir)
+{
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    for (int32_t slot = 0; slot < 8; slot++)
+    {
+        std::ofstream file(dir / (std::to_string(kEdos[slot]) + "edo.scl"));
+        file << "! " << kEdos[slot] << "edo.scl\n" << kEdos[slot] << " equal divisions of the octave\n " << kEdos[slot] << "\n!\n";
+        for (int32_t i = 1; i <= kEdos[slot]; i++)
+            file << " " << (1200.0 * i / kEdos[slot]) << "\n";
+        if (!file)
+            return false;
+    }
+    return true;
+}
+
+static Result runScenario(const Scenario& scenario, const fs::path& scaleDir, double seconds, uint32_t blockSize, double sampleRate,
+                          uint32_t instances, int32_t lanes)
+{
+    BenchHost host;
+#if SCALESEQUENCE_PLUS_PLUGGABLE_SINK
+    std::vector<NullTuningSink> sinks(instances);
+#else
+    MtsEspTuningSink::setBenchmarking(true);
+#endif
+    std::vector<std::unique_ptr<ScaleSequencePlusCore>> cores;
+
+    for (uint32_t n = 0; n < instances; n++)
+    {
+        std::unique_ptr<ScaleSequencePlusCore> core(new ScaleSequencePlusCore(host));
+#if SCALESEQUENCE_PLUS_PLUGGABLE_SINK
+        core->setTuningSink(&sinks[n]);
+#endif
+
+        for (int32_t slot = 1; slot <= 8; slot++)
+            core->loadScl(slot, (scaleDir / (std::to_string(kEdos[slot - 1]) + "edo.scl")).string().c_str());
+
+        for (int32_t lane = 0; lane < lanes; lane++)
+        {
+            core->setParameterValue(laneParameter(lane, kLaneLoopPoint), static_cast<float>(kLaneLoopPoints[lane]));
+            for (int32_t step = 0; step < kNumSteps; step++)
+                core->setParameterValue(laneParameter(lane, kLaneStep1 + step), static_cast<float>(1 + (step + lane) % 8));
+        }
+        core->setParameterValue(kParameterLanes, static_cast<float>(lanes));
+        core->setParameterValue(kParameterMeasure, scenario.measure);
+        core->setParameterValue(kParameterScaleGlide, scenario.glide);
+        core->setParameterValue(kParameterSysExMode, scenario.sysExMode);
+        core->setParameterValue(kParameterMpeOutput, scenario.mpeOutput);
+
+        core->activate(sampleRate);
+        cores.push_back(std::move(core));
+    }
+
+    const double ticksPerBeat = 1920.0;
+    const int32_t beatsPerBar = 4;
+    const double framesPerBeat = sampleRate * 60.0 / scenario.bpm;
+
+    const uint64_t totalFrames = static_cast<uint64_t>(seconds * sampleRate);
+    std::vector<ScaleSequencePlusMidiEvent> events;
+    uint64_t nextNote = 0;
+    uint8_t noteNumber = 60;
+
+    ScaleSequencePlusTransport transport = {};
+    transport.playing = true;
+    transport.bbt.valid = true;
+    transport.bbt.ticksPerBeat = ticksPerBeat;
+    transport.bbt.beatsPerBar = beatsPerBar;
+    transport.bbt.beatsPerMinute = scenario.bpm;
+
+    double totalNs = 0.0;
+    double bestNs = 1e300;
+    uint64_t blocks = 0;
+
+    for (uint64_t start = 0; start < totalFrames; start += blockSize)
+    {
+        const uint32_t frames = static_cast<uint32_t>(std::min<uint64_t>(blockSize, totalFrames - start));
+
+        const double beats = start / framesPerBeat;
+        const int64_t wholeBeats = static_cast<int64_t>(beats);
+        transport.frame = start;
+        transport.bbt.bar = static_cast<int32_t>(wholeBeats / beatsPerBar) + 1;
+        transport.bbt.beat = static_cast<int32_t>(wholeBeats % beatsPerBar) + 1;
+        transport.bbt.tick = (beats - wholeBeats) * ticksPerBeat;
+
+        // Note on and off pairs, a quarter of the note length apart
+        events.clear();
+        if (scenario.notesPerBeat > 0.0)
+        {
+            const uint64_t noteFrames = static_cast<uint64_t>(framesPerBeat / scenario.notesPerBeat);
+            for (; nextNote < start + frames; nextNote += noteFrames)
+            {
+                if (nextNote < start)
+                    continue;
+                const uint32_t frame = static_cast<uint32_t>(nextNote - start);
+                events.push_back({ frame, 3, { 0x90, noteNumber, 100, 0 }, nullptr });
+                events.push_back({ std::min(frame + static_cast<uint32_t>(noteFrames / 4), frames - 1), 3, { 0x80, noteNumber, 0, 0 }, nullptr });
+                noteNumber = static_cast<uint8_t>(48 + (noteNumber - 47) % 36);
+            }
+            std::stable_sort(events.begin(), events.end(),
+                             [](const ScaleSequencePlusMidiEvent& a, const ScaleSequencePlusMidiEvent& b) { return a.frame < b.frame; });
+        }
+
+        const auto blockStart = std::chrono::steady_clock::now();
+        for (const std::unique_ptr<ScaleSequencePlusCore>& core : cores)
+            core->run(frames, transport, events.data(), static_cast<uint32_t>(events.size()));
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - blockStart).count();
+
+        if (frames == blockSize)
+        {
+            totalNs += ns;
+            bestNs = std::min(bestNs, ns);
+            ++blocks;
+        }
+    }
+
+    // A master publishes its table in every block
+    const uint32_t idleCores = static_cast<uint32_t>(std::count_if(cores.begin(), cores.end(), [](const std::unique_ptr<ScaleSequencePlusCore>& core) {
+        return core->getParameterValue(kParameterMasterStatus) == 0.0f;
+    }));
+
+    for (const std::unique_ptr<ScaleSequencePlusCore>& core : cores)
+        core->deactivate();
+
+    Result result;
+    result.meanNs = blocks != 0 ? totalNs / blocks : 0.0;
+    result.bestNs = blocks != 0 ? bestNs : 0.0;
+    result.realtime = result.meanNs > 0.0 ? (blockSize / sampleRate * 1e9) / result.meanNs : 0.0;
+    result.idleCores = idleCores;
+    return result;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static std::map<std::string, double> readResults(const char* path)
+{
+    std::map<std::string, double> results;
+    std::ifstream file(path);
+    std::string name;
+    double meanNs = 0.0;
+    while (file >> name >> meanNs)
+    {
+        results[name] = meanNs;
+        file.ignore(1 << 20, '\n');
+    }
+    return results;
+}
+
+static bool parseDouble(const char* text, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+static int usage(const char* name, const char* error = nullptr)
+{
+    if (error != nullptr)
+        std::fprintf(stderr, "%s\n", error);
+    std::fprintf(stderr, "Usage: %s [--scenario <name>] [--seconds <n>] [--repeat <n>] [--block-size <n>]\n"
+                         "       [--sample-rate <n>] [--instances <n>] [--lanes <n>] [--save <file>] [--compare <file>]\n"
+                         "Scenarios:", name);
+    for (const Scenario& scenario : kScenarios)
+        std::fprintf(stderr, " %s", scenario.name);
+    std::fprintf(stderr, "\n");
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<const Scenario*> scenarios;
+    const char* savePath = nullptr;
+    const char* comparePath = nullptr;
+    double seconds = 60.0;
+    double repeat = 3.0;
+    double blockSize = 256.0;
+    double sampleRate = 48000.0;
+    double instances = 1.0;
+    double lanes = 1.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--scenario" && hasValue)
+        {
+            const std::string name(argv[++i]);
+            const Scenario* found = nullptr;
+            for (const Scenario& scenario : kScenarios)
+                if (name == scenario.name)
+                    found = &scenario;
+            if (found == nullptr)
+                return usage(argv[0], ("Unknown scenario: " + name).c_str());
+            scenarios.push_back(found);
+        }
+        else if (arg == "--seconds" && hasValue && parseDouble(argv[i + 1], seconds) && seconds > 0.0)
+            ++i;
+        else if (arg == "--repeat" && hasValue && parseDouble(argv[i + 1], repeat) && repeat >= 1.0)
+            ++i;
+        else if (arg == "--block-size" && hasValue && parseDouble(argv[i + 1], blockSize) && blockSize >= 1.0)
+            ++i;
+        else if (arg == "--sample-rate" && hasValue && parseDouble(argv[i + 1], sampleRate) && sampleRate > 0.0)
+            ++i;
+        else if (arg == "--instances" && hasValue && parseDouble(argv[i + 1], instances) && instances >= 1.0)
+            ++i;
+        else if (arg == "--lanes" && hasValue && parseDouble(argv[i + 1], lanes) && lanes >= 1.0 && lanes <= kNumLanes)
+            ++i;
+        else if (arg == "--save" && hasValue)
+            savePath = argv[++i];
+        else if (arg == "--compare" && hasValue)
+            comparePath = argv[++i];
+        else
+            return usage(argv[0], ("Bad option: " + arg).c_str());
+    }
+
+    if (scenarios.empty())
+        for (const Scenario& scenario : kScenarios)
+            scenarios.push_back(&scenario);
+
+    const fs::path scaleDir = fs::temp_directory_path() / "scalesequence-bench-core";
+    if (!writeScales(scaleDir))
+    {
+        std::fprintf(stderr, "Could not write the scales to %s\n", scaleDir.string().c_str());
+        return 1;
+    }
+
+    const std::map<std::string, double> baseline = comparePath != nullptr ? readResults(comparePath) : std::map<std::string, double>();
+    if (comparePath != nullptr && baseline.empty())
+        std::fprintf(stderr, "No results in %s\n", comparePath);
+
+    std::FILE* const save = savePath != nullptr ? std::fopen(savePath, "w") : nullptr;
+    if (savePath != nullptr && save == nullptr)
+    {
+        std::fprintf(stderr, "Could not write %s\n", savePath);
+        return 1;
+    }
+
+    std::printf("%-8s %12s %12s %10s\n", "scenario", "mean ns", "best ns", "realtime");
+    int status = 0;
+
+    for (const Scenario* scenario : scenarios)
+    {
+        Result best = runScenario(*scenario, scaleDir, seconds, static_cast<uint32_t>(blockSize), sampleRate, static_cast<uint32_t>(instances),
+                                  static_cast<int32_t>(lanes));
+        for (int32_t run = 1; run < static_cast<int32_t>(repeat); run++)
+        {
+            const Result result = runScenario(*scenario, scaleDir, seconds, static_cast<uint32_t>(blockSize), sampleRate, static_cast<uint32_t>(instances),
+                                              static_cast<int32_t>(lanes));
+            if (result.meanNs < best.meanNs)
+                best = result;
+        }
+
+        std::printf("%-8s %12.0f %12.0f %9.0fx", scenario->name, best.meanNs, best.bestNs, best.realtime);
+
+        const auto before = baseline.find(scenario->name);
+        if (before != baseline.end() && before->second > 0.0)
+            std::printf("  %+6.1f%% (was %.0f ns)", (best.meanNs / before->second - 1.0) * 100.0, before->second);
+        std::printf("\n");
+
+        if (save != nullptr)
+            std::fprintf(save, "%s %.1f %.1f\n", scenario->name, best.meanNs, best.bestNs);
+
+        if (best.idleCores != 0)
+        {
+            std::fprintf(stderr, "%s: %u of %u cores published no tuning tables\n", scenario->name, best.idleCores, static_cast<uint32_t>(instances));
+            status = 2;
+        }
+    }
+
+    if (save != nullptr)
+        std::fclose(save);
+
+    return status;
+}
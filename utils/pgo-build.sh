@@ -0,0 +1,52 @@
+#!/bin/sh
+# Build the plugin with link-time and profile-guided optimization, and show what it gained.
+#
+#   1. an LTO build, benchmarked with scalesequence-bench-core to get the baseline
+#   2. an instrumented build; the benchmark scenarios are the training run
+#   3. the optimized build from that profile, benchmarked against the baseline
+#
+# Usage: utils/pgo-build.sh [build directory] [extra cmake options...]
+# The build directory defaults to build-pgo. The plugins end up in its bin folder, as in any other build.
+# The same build directory is used for all three steps, because GCC names the profile after the object files.
+
+set -e
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${1:-build-pgo}
+[ $# -gt 0 ] && shift
+mkdir -p "$BUILD_DIR"
+BUILD_DIR=$(cd "$BUILD_DIR" && pwd)
+PROFILE_DIR="$BUILD_DIR/pgo-profile"
+JOBS=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 4)
+
+configure() {
+    PGO=$1
+    shift
+    cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DCMAKE_BUILD_TYPE=Release -DSCALESEQUENCE_PLUS_UTILS=ON \
+          -DSCALESEQUENCE_PLUS_LTO=ON -DSCALESEQUENCE_PLUS_PGO="$PGO" -DSCALESEQUENCE_PLUS_PGO_DIR="$PROFILE_DIR" "$@"
+}
+
+build() {
+    cmake --build "$BUILD_DIR" -j"$JOBS"
+    BENCH=$(find "$BUILD_DIR" -name scalesequence-bench-core -type f -perm -u+x | head -n 1)
+}
+
+echo "== LTO build"
+configure OFF "$@"
+build
+"$BENCH" --save "$BUILD_DIR/bench-lto.txt"
+
+echo "== Instrumented build and training run"
+rm -rf "$PROFILE_DIR"
+configure GENERATE "$@"
+build
+# The bench exits with an error if a core did no tuning work; a profile without it is no use
+if ! "$BENCH" --repeat 1 > /dev/null; then
+    echo "The training run failed, not building with its profile" >&2
+    exit 1
+fi
+
+echo "== LTO + PGO build"
+configure USE "$@"
+build
+"$BENCH" --compare "$BUILD_DIR/bench-lto.txt" | tee "$BUILD_DIR/bench-pgo.txt"
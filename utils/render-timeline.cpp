@@ -0,0 +1,526 @@
+/*
+ * Simulate ScaleSequence-Plus over a whole session, faster than real time, and write the tuning timeline:
+ * which 128-note table was published at every point. See timeline-format.hpp for the file layout.
+ *
+ * The session is played into the plugin's own sequencer core (scalesequence-core), block by block like a host
+ * calling run(): the transport is worked out from the tempo map and time signatures at the start of each block, and
+ * the note ons go in as MIDI. The core publishes to a sink that keeps the last table instead of MTS-ESP, so what is
+ * written is what the plugin would have published, steps starting on their frame within the block included. Only
+ * the glide is done differently: the core jumps it in closed form from one step start to the next (setOfflineGlide())
+ * instead of working out every frame, which arrives at the same tables up to rounding.
+ * A smaller --block-size gives a finer timeline. Each record holds the table published in the block it starts, so
+ * a glide is seen one block at a time.
+ *
+ * Usage: scalesequence-render-timeline [options] -o <output file>
+ *   --midi <file.mid>          tempo map and time signatures, and the notes that advance the step with --step-type note
+ *   --bpm <n>                  tempo without a MIDI file (default 120)
+ *   --time-signature <n/d>     time signature without a MIDI file (default 4/4)
+ *   --seconds <n>              length of the session (default: the end of the MIDI file)
+ *   --scl <slot> <file.scl>    load a scale into slot 1 to 8
+ *   --kbm <slot> <file.kbm>    load a keyboard mapping into slot 1 to 8
+ *   --steps <s1,s2,...>        scale for each step, up to 32 (default all 1)
+ *   --step-type <beats|bars|note>
+ *   --step-multi <n>  --glide <n>  --offset <n>  --loop-point <n>
+ *   --sample-rate <n>          (default 48000)
+ *   --block-size <n>           (default 512)
+ */
+
+#include "ScaleSequencePlusCore.hpp"
+#include "timeline-format.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------------------------------------------------
+// Standard MIDI file: just the tempo map, time signatures and note ons
+
+struct MidiTempo { double tick; double usPerQuarter; double seconds; };
+struct MidiTimeSignature { double tick; int32_t numerator; int32_t denominator; double bar; };
+struct MidiNoteOn { double tick; uint8_t data[3]; };
+
+struct MidiSong
+{
+    uint32_t ticksPerQuarter = 480;
+    std::vector<MidiTempo> tempos;
+    std::vector<MidiTimeSignature> timeSignatures;
+    std::vector<MidiNoteOn> noteOns;
+    double endTick = 0.0;
+};
+
+static uint32_t readBigEndian(const uint8_t* p, uint32_t bytes)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < bytes; i++)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+static bool readMidiFile(const char* path, MidiSong& song)
+{
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() < 14 || std::memcmp(data.data(), "MThd", 4) != 0)
+        return false;
+
+    const uint32_t headerSize = readBigEndian(&data[4], 4);
+    const uint32_t trackCount = readBigEndian(&data[10], 2);
+    const uint32_t division = readBigEndian(&data[12], 2);
+    if (division & 0x8000)
+    {
+        std::fprintf(stderr, "%s: SMPTE time division is not supported\n", path);
+        return false;
+    }
+    song.ticksPerQuarter = division;
+
+    std::vector<std::pair<double, double>> tempos;                  // tick, us per quarter
+    std::vector<std::pair<double, std::pair<int, int>>> signatures; // tick, n/d
+    size_t pos = 8 + headerSize;
+
+    for (uint32_t track = 0; track < trackCount && pos + 8 <= data.size(); track++)
+    {
+        if (std::memcmp(&data[pos], "MTrk", 4) != 0)
+            return false;
+
+        const size_t end = std::min(data.size(), pos + 8 + readBigEndian(&data[pos + 4], 4));
+        pos += 8;
+
+        double tick = 0.0;
+        uint8_t status = 0;
+
+        auto readVariable = [&]() {
+            uint32_t value = 0;
+            while (pos < end)
+            {
+                const uint8_t byte = data[pos++];
+                value = (value << 7) | (byte & 0x7F);
+                if ((byte & 0x80) == 0)
+                    break;
+            }
+            return value;
+        };
+
+        while (pos < end)
+        {
+            tick += readVariable();
+            if (pos >= end)
+                break;
+
+            if (data[pos] & 0x80)
+                status = data[pos++];
+
+            if (status == 0xFF)
+            {
+                const uint8_t type = data[pos++];
+                const uint32_t length = readVariable();
+                if (pos + length > end)
+                    break;
+                if (type == 0x51 && length == 3)
+                    tempos.push_back(std::make_pair(tick, static_cast<double>(readBigEndian(&data[pos], 3))));
+                else if (type == 0x58 && length >= 2)
+                    signatures.push_back(std::make_pair(tick, std::make_pair(int(data[pos]), 1 << data[pos + 1])));
+                pos += length;
+                status = 0;
+            }
+            else if (status == 0xF0 || status == 0xF7)
+            {
+                pos += readVariable();
+                status = 0;
+            }
+            else
+            {
+                const uint8_t type = status & 0xF0;
+                const uint32_t length = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+                if (pos + length > end)
+                    break;
+                if (type == 0x90 && data[pos + 1] != 0)
+                    song.noteOns.push_back({ tick, { status, data[pos], data[pos + 1] } });
+                pos += length;
+            }
+        }
+
+        song.endTick = std::max(song.endTick, tick);
+        pos = end;
+    }
+
+    std::stable_sort(tempos.begin(), tempos.end(),
+                     [](const std::pair<double, double>& a, const std::pair<double, double>& b) { return a.first < b.first; });
+    std::stable_sort(signatures.begin(), signatures.end(),
+                     [](const std::pair<double, std::pair<int, int>>& a, const std::pair<double, std::pair<int, int>>& b) { return a.first < b.first; });
+    std::stable_sort(song.noteOns.begin(), song.noteOns.end(),
+                     [](const MidiNoteOn& a, const MidiNoteOn& b) { return a.tick < b.tick; });
+
+    // Defaults from the MIDI file spec: 120 bpm, 4/4
+    if (tempos.empty() || tempos.front().first > 0.0)
+        tempos.insert(tempos.begin(), std::make_pair(0.0, 500000.0));
+    if (signatures.empty() || signatures.front().first > 0.0)
+        signatures.insert(signatures.begin(), std::make_pair(0.0, std::make_pair(4, 4)));
+
+    song.tempos.clear();
+    double seconds = 0.0;
+    for (size_t i = 0; i < tempos.size(); i++)
+    {
+        if (i > 0)
+            seconds += (tempos[i].first - tempos[i - 1].first) * tempos[i - 1].second * 1e-6 / song.ticksPerQuarter;
+        song.tempos.push_back({ tempos[i].first, tempos[i].second, seconds });
+    }
+
+    song.timeSignatures.clear();
+    double bar = 0.0;
+    for (size_t i = 0; i < signatures.size(); i++)
+    {
+        if (i > 0)
+        {
+            const MidiTimeSignature& last(song.timeSignatures.back());
+            const double ticksPerBar = last.numerator * song.ticksPerQuarter * 4.0 / last.denominator;
+            // A new time signature starts a new bar, even if the last one was cut short
+            bar += std::ceil((signatures[i].first - last.tick) / ticksPerBar - 1e-9);
+        }
+        song.timeSignatures.push_back({ signatures[i].first, signatures[i].second.first, signatures[i].second.second, bar });
+    }
+
+    return true;
+}
+
+static double secondsToTick(const MidiSong& song, double seconds, size_t& cursor)
+{
+    while (cursor + 1 < song.tempos.size() && song.tempos[cursor + 1].seconds <= seconds)
+        ++cursor;
+    const MidiTempo& t(song.tempos[cursor]);
+    return t.tick + (seconds - t.seconds) * 1e6 / t.usPerQuarter * song.ticksPerQuarter;
+}
+
+static double tickToSeconds(const MidiSong& song, double tick)
+{
+    size_t i = 0;
+    while (i + 1 < song.tempos.size() && song.tempos[i + 1].tick <= tick)
+        ++i;
+    const MidiTempo& t(song.tempos[i]);
+    return t.seconds + (tick - t.tick) * t.usPerQuarter * 1e-6 / song.ticksPerQuarter;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// What the core publishes, and what it tells its host
+
+/**
+   Keeps where the last global table the core published is, instead of handing it to MTS-ESP. The core publishes from
+   a table of its own, so it is only copied when the record is taken after run(). The core is always the master.
+ */
+class TimelineTuningSink final : public TuningSink
+{
+public:
+    const double* table = nullptr;
+
+    bool registerMaster(const void*) override { return true; }
+    void deregisterMaster() override {}
+    void setNoteTunings(const double freqs[128]) override { table = freqs; }
+    void setScaleName(const char*) override {}
+    void filterNote(bool, char, char) override {}
+    void clearNoteFilter() override {}
+    void setMultiChannel(bool, char) override {}
+    void setMultiChannelNoteTunings(const double[128], char) override {}
+};
+
+/**
+   Throws the MIDI output away, and keeps the first tuning file the core could not load.
+ */
+class TimelineHost : public ScaleSequencePlusHost
+{
+public:
+    std::string error;
+
+    void sendMidiEvent(const ScaleSequencePlusMidiEvent&) override
+    {
+    }
+
+    void tuningFileInfoChanged(States, const TuningFileInfo& info) override
+    {
+        if (!info.valid && error.empty())
+            error = info.error;
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static bool parseInt(const char* text, int32_t& value)
+{
+    char* end = nullptr;
+    const long v = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0')
+        return false;
+    value = static_cast<int32_t>(v);
+    return true;
+}
+
+static bool parseDouble(const char* text, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+static int usage(const char* name, const char* error = nullptr)
+{
+    if (error != nullptr)
+        std::fprintf(stderr, "%s\n", error);
+    std::fprintf(stderr, "Usage: %s [--midi <file.mid>] [--bpm <n>] [--time-signature <n/d>] [--seconds <n>]\n"
+                         "       [--scl <slot> <file>] [--kbm <slot> <file>] [--steps <s1,s2,...>] [--step-type beats|bars|note]\n"
+                         "       [--step-multi <n>] [--glide <n>] [--offset <n>] [--loop-point <n>]\n"
+                         "       [--sample-rate <n>] [--block-size <n>] -o <output file>\n", name);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* midiPath = nullptr;
+    const char* outputPath = nullptr;
+    const char* sclPaths[9] = {};
+    const char* kbmPaths[9] = {};
+    double bpm = 120.0;
+    int32_t sigNumerator = 4;
+    int32_t sigDenominator = 4;
+    double seconds = -1.0;
+    double sampleRate = 48000.0;
+    int32_t blockSize = 512;
+
+    float params[kParameterCount];
+    std::copy(ParameterDefaults.begin(), ParameterDefaults.end(), params);
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        double number = 0.0;
+        int32_t slot = 0;
+
+        if (arg == "-o" && hasValue)
+            outputPath = argv[++i];
+        else if (arg == "--midi" && hasValue)
+            midiPath = argv[++i];
+        else if (arg == "--bpm" && hasValue && parseDouble(argv[i + 1], bpm) && bpm > 0.0)
+            ++i;
+        else if (arg == "--time-signature" && hasValue
+                 && std::sscanf(argv[i + 1], "%d/%d", &sigNumerator, &sigDenominator) == 2 && sigNumerator > 0 && sigDenominator > 0)
+            ++i;
+        else if (arg == "--seconds" && hasValue && parseDouble(argv[i + 1], seconds) && seconds >= 0.0)
+            ++i;
+        else if ((arg == "--scl" || arg == "--kbm") && i + 2 < argc && parseInt(argv[i + 1], slot) && slot >= 1 && slot <= 8)
+        {
+            (arg == "--scl" ? sclPaths : kbmPaths)[slot] = argv[i + 2];
+            i += 2;
+        }
+        else if (arg == "--steps" && hasValue)
+        {
+            std::string list(argv[++i]);
+            int32_t step = 0;
+            for (size_t start = 0; start <= list.size() && step < kNumSteps; step++)
+            {
+                const size_t comma = std::min(list.find(',', start), list.size());
+                int32_t value = 0;
+                if (!parseInt(list.substr(start, comma - start).c_str(), value))
+                    return usage(argv[0], "--steps needs a comma separated list of scale numbers");
+                params[kParameterStep1 + step] = limit<float>(value, controlLimits[kParameterStep1].first, controlLimits[kParameterStep1].second);
+                start = comma + 1;
+            }
+        }
+        else if (arg == "--step-type" && hasValue)
+        {
+            const std::string type(argv[++i]);
+            if (type == "beats")
+                params[kParameterMeasure] = 0.0f;
+            else if (type == "bars")
+                params[kParameterMeasure] = 1.0f;
+            else if (type == "note")
+                params[kParameterMeasure] = 2.0f;
+            else
+                return usage(argv[0], "--step-type must be beats, bars or note");
+        }
+        else if ((arg == "--step-multi" || arg == "--glide" || arg == "--offset" || arg == "--loop-point")
+                 && hasValue && parseDouble(argv[i + 1], number))
+        {
+            const Parameters p = arg == "--step-multi" ? kParameterMultiplier
+                               : arg == "--glide" ? kParameterScaleGlide
+                               : arg == "--offset" ? kParameterOffset : kParameterLoopPoint;
+            params[p] = limit<float>(static_cast<float>(number), controlLimits[p].first, controlLimits[p].second);
+            ++i;
+        }
+        else if (arg == "--sample-rate" && hasValue && parseDouble(argv[i + 1], sampleRate) && sampleRate > 0.0)
+            ++i;
+        else if (arg == "--block-size" && hasValue && parseInt(argv[i + 1], blockSize) && blockSize > 0)
+            ++i;
+        else
+            return usage(argv[0], ("Bad option: " + arg).c_str());
+    }
+
+    if (outputPath == nullptr)
+        return usage(argv[0], "No output file given");
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // Tempo map
+    MidiSong song;
+    if (midiPath != nullptr)
+    {
+        if (!readMidiFile(midiPath, song))
+        {
+            std::fprintf(stderr, "Could not read MIDI file %s\n", midiPath);
+            return 1;
+        }
+        if (seconds < 0.0)
+            seconds = tickToSeconds(song, song.endTick);
+    }
+    else
+    {
+        song.tempos.push_back({ 0.0, 60e6 / bpm, 0.0 });
+        song.timeSignatures.push_back({ 0.0, sigNumerator, sigDenominator, 0.0 });
+        if (seconds < 0.0)
+            return usage(argv[0], "--seconds is needed without a MIDI file");
+    }
+
+    // The core, set up as the plugin would be after loading a state with these settings
+    TimelineHost host;
+    TimelineTuningSink sink;
+    ScaleSequencePlusCore core(host);
+    core.setTuningSink(&sink);
+    core.setOfflineGlide(true);
+
+    for (int32_t slot = 1; slot <= 8; slot++)
+    {
+        if (sclPaths[slot] != nullptr)
+            core.loadScl(slot, sclPaths[slot]);
+        if (kbmPaths[slot] != nullptr)
+            core.loadKbm(slot, kbmPaths[slot]);
+        if (!host.error.empty())
+        {
+            std::fprintf(stderr, "Slot %d: %s\n", slot, host.error.c_str());
+            return 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < kParameterCount; i++)
+        core.setParameterValue(i, params[i]);
+
+    // The current step output starts out on the last step, as in the plugin. From 0 the records before the start of
+    // the sequence say so.
+    core.setParameterValue(kParameterCurrentStep, 0.0f);
+
+    // The note ons, in samples
+    std::vector<uint64_t> noteOnSamples;
+    for (const MidiNoteOn& note : song.noteOns)
+        noteOnSamples.push_back(static_cast<uint64_t>(tickToSeconds(song, note.tick) * sampleRate));
+
+    // Play the session, block by block
+    const uint64_t totalSamples = static_cast<uint64_t>(seconds * sampleRate);
+    const double ticksPerBeat = 1920.0;
+
+    size_t tempoCursor = 0;
+    size_t signatureCursor = 0;
+    size_t noteCursor = 0;
+    std::vector<ScaleSequencePlusMidiEvent> events;
+    ScaleSequencePlusTransport transport = {};
+    transport.playing = true;
+    transport.bbt.valid = true;
+    transport.bbt.ticksPerBeat = ticksPerBeat;
+
+    // The snapshot for the tuning view says which scale the core is gliding to
+    TuningSnapshotRing& snapshots(core.getTuningSnapshots());
+    TuningSnapshot snapshot;
+    uint32_t snapshotsSeen = 0;
+    int32_t scale = 0;
+
+    std::vector<TimelineRecord> records;
+    TimelineRecord record;
+
+    core.activate(sampleRate);
+
+    for (uint64_t start = 0; start < totalSamples; start += blockSize)
+    {
+        const uint32_t frames = static_cast<uint32_t>(std::min<uint64_t>(blockSize, totalSamples - start));
+
+        // Host position at the start of the block, as DPF reports it: bars and beats from 1, and the tempo in
+        // beats of the time signature per minute
+        const double tick = secondsToTick(song, start / sampleRate, tempoCursor);
+        while (signatureCursor + 1 < song.timeSignatures.size() && song.timeSignatures[signatureCursor + 1].tick <= tick)
+            ++signatureCursor;
+        const MidiTimeSignature& sig(song.timeSignatures[signatureCursor]);
+        const double midiTicksPerBeat = song.ticksPerQuarter * 4.0 / sig.denominator;
+        const double beats = (tick - sig.tick) / midiTicksPerBeat;
+        const double barsInto = std::floor(beats / sig.numerator);
+        const double beatInBar = beats - barsInto * sig.numerator;
+
+        transport.frame = start;
+        transport.bbt.bar = static_cast<int32_t>(sig.bar + barsInto) + 1;
+        transport.bbt.beat = static_cast<int32_t>(beatInBar) + 1;
+        transport.bbt.tick = (beatInBar - std::floor(beatInBar)) * ticksPerBeat;
+        transport.bbt.beatsPerBar = static_cast<float>(sig.numerator);
+        transport.bbt.beatsPerMinute = 60e6 / song.tempos[tempoCursor].usPerQuarter * sig.denominator / 4.0;
+
+        // The note ons of the block, at their frame
+        events.clear();
+        for (; noteCursor < noteOnSamples.size() && noteOnSamples[noteCursor] < start + frames; ++noteCursor)
+        {
+            ScaleSequencePlusMidiEvent event = {};
+            event.frame = static_cast<uint32_t>(std::max(noteOnSamples[noteCursor], start) - start);
+            event.size = 3;
+            std::memcpy(event.data, song.noteOns[noteCursor].data, 3);
+            events.push_back(event);
+        }
+
+        snapshots.request();
+        core.run(frames, transport, events.data(), static_cast<uint32_t>(events.size()));
+        if (snapshots.read(snapshot, snapshotsSeen))
+            scale = snapshot.scale;
+
+        // The current step output counts steps from 1, 0 before the start of the sequence
+        const int32_t step = static_cast<int32_t>(std::lround(core.getParameterValue(kParameterCurrentStep) / 0.03125f)) - 1;
+
+        // A record is only written when the table or the step changed
+        if (sink.table != nullptr
+            && (records.empty() || record.step != step || std::memcmp(record.hz, sink.table, sizeof(record.hz)) != 0))
+        {
+            record.sample = start;
+            record.step = step;
+            record.scale = scale;
+            std::memcpy(record.hz, sink.table, sizeof(record.hz));
+            records.push_back(record);
+        }
+    }
+
+    // Before the sink goes
+    core.deactivate();
+
+    // Write the file
+    std::FILE* const out = std::fopen(outputPath, "wb");
+    if (out == nullptr)
+    {
+        std::fprintf(stderr, "Could not write %s\n", outputPath);
+        return 1;
+    }
+
+    TimelineFileHeader header;
+    std::memcpy(header.magic, kTimelineFileMagic, sizeof(header.magic));
+    header.version = kTimelineFileVersion;
+    header.recordSize = sizeof(TimelineRecord);
+    header.sampleRate = sampleRate;
+    header.recordCount = records.size();
+    header.totalSamples = totalSamples;
+
+    const bool written = std::fwrite(&header, sizeof(header), 1, out) == 1
+                      && std::fwrite(records.data(), sizeof(TimelineRecord), records.size(), out) == records.size();
+    if (std::fclose(out) != 0 || !written)
+    {
+        std::fprintf(stderr, "Could not write %s\n", outputPath);
+        return 1;
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::fprintf(stderr, "%.1f s of session, %zu records, simulated in %.3f s\n", seconds, records.size(), elapsed);
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef SCALESEQUENCE_PLUS_TIMELINE_FORMAT_HPP
+#define SCALESEQUENCE_PLUS_TIMELINE_FORMAT_HPP
+
+#include <cstdint>
+
+// Tuning timeline written by scalesequence-render-timeline.
+// The file is a TimelineFileHeader followed by recordCount TimelineRecords, all little endian and 8-byte aligned,
+// so it can be memory-mapped and used in place. Records are sorted by sample; a record is only written when the
+// table changed, so the table in effect at sample t is the one in the last record with sample <= t
+// (a binary search over the records).
+
+static const char kTimelineFileMagic[8] = { 'S', 'S', 'P', 'T', 'L', 'I', 'N', 'E' };
+static const uint32_t kTimelineFileVersion = 1;
+
+struct TimelineFileHeader
+{
+    char magic[8];          // kTimelineFileMagic
+    uint32_t version;       // kTimelineFileVersion
+    uint32_t recordSize;    // sizeof(TimelineRecord)
+    double sampleRate;
+    uint64_t recordCount;
+    uint64_t totalSamples;  // length of the simulated session
+};
+
+struct TimelineRecord
+{
+    uint64_t sample;        // first sample of the block that published this table
+    int32_t step;           // sequence step, from 0, or -1 before the start
+    int32_t scale;          // scale being glided to, 1 to 8, or 0 before the first switch
+    double hz[128];         // frequency of each MIDI note, as published to MTS-ESP
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * Convert a ScaleSequence-Plus trace file to the Chrome trace event JSON format,
+ * which can be opened in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+ *
+ * Usage: scalesequence-trace-to-json <trace file> [<output.json>]
+ *
+ * Record a trace by running the host with SCALESEQUENCE_PLUS_TRACE_FILE set, see ScaleSequencePlusTrace.hpp.
+ */
+
+#include "ScaleSequencePlusTrace.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+static void writeEvent(std::FILE* out, bool& first, const char* name, const char* phase, double us, const char* args)
+{
+    std::fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":1", first ? "" : ",", name, phase, us);
+    if (phase[0] == 'i')
+        std::fprintf(out, ",\"s\":\"t\"");
+    if (args != nullptr)
+        std::fprintf(out, ",\"args\":{%s}", args);
+    std::fprintf(out, "}");
+    first = false;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::fprintf(stderr, "Usage: %s <trace file> [<output.json>]\n", argv[0]);
+        return 1;
+    }
+
+    std::FILE* const in = std::fopen(argv[1], "rb");
+    if (in == nullptr)
+    {
+        std::fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    TraceFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, in) != 1
+        || std::memcmp(header.magic, kTraceFileMagic, sizeof(header.magic)) != 0
+        || header.version != kTraceFileVersion
+        || header.eventSize != sizeof(TraceEvent))
+    {
+        std::fprintf(stderr, "%s is not a ScaleSequence-Plus trace file this tool can read\n", argv[1]);
+        std::fclose(in);
+        return 1;
+    }
+
+    std::FILE* const out = argc == 3 ? std::fopen(argv[2], "w") : stdout;
+    if (out == nullptr)
+    {
+        std::fprintf(stderr, "Could not write %s\n", argv[2]);
+        std::fclose(in);
+        return 1;
+    }
+
+    std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    std::fprintf(out, "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"ScaleSequence-Plus run()\"}}");
+
+    bool first = false;
+    bool gliding = false;
+    double sampleRate = 48000.0;
+    double activationUs = 0.0; // time of the last activation; frames count from there
+    double lastUs = 0.0;
+    char args[64];
+
+    TraceEvent event;
+    while (std::fread(&event, sizeof(event), 1, in) == 1)
+    {
+        if (event.type >= kTraceEventTypeCount)
+        {
+            std::fprintf(stderr, "Skipping unknown event type %u\n", event.type);
+            continue;
+        }
+
+        const char* const name = kTraceEventNames[event.type];
+        double us = activationUs + static_cast<double>(event.frame) * 1e6 / sampleRate;
+
+        switch (event.type)
+        {
+        case kTraceActivate:
+            // Carry on after the last event seen, the time in between is not known
+            if (event.value > 0)
+                sampleRate = event.value;
+            activationUs = lastUs;
+            us = lastUs;
+            std::snprintf(args, sizeof(args), "\"sample rate\":%d", event.value);
+            writeEvent(out, first, name, "i", us, args);
+            break;
+        case kTraceStep:
+            std::snprintf(args, sizeof(args), "\"step\":%d", event.value + 1);
+            writeEvent(out, first, name, "i", us, args);
+            break;
+        case kTraceLaneStep:
+            std::snprintf(args, sizeof(args), "\"lane\":%d,\"step\":%d", event.value >> 8, event.value & 0xFF);
+            writeEvent(out, first, name, "i", us, args);
+            break;
+        case kTraceScaleSwitch:
+            std::snprintf(args, sizeof(args), "\"scale\":%d", event.value);
+            writeEvent(out, first, name, "i", us, args);
+            break;
+        case kTraceGlideStart:
+            writeEvent(out, first, "glide", "B", us, nullptr);
+            gliding = true;
+            break;
+        case kTraceGlideEnd:
+            if (gliding)
+                writeEvent(out, first, "glide", "E", us, nullptr);
+            gliding = false;
+            break;
+        case kTracePublish:
+            std::snprintf(args, sizeof(args), "\"tables\":%d", event.value);
+            writeEvent(out, first, "MTS-ESP publishes", "C", us, args);
+            break;
+        case kTraceMidiTrigger:
+            std::snprintf(args, sizeof(args), "\"note\":%d", event.value);
+            writeEvent(out, first, name, "i", us, args);
+            break;
+        case kTraceTransportJump:
+            std::snprintf(args, sizeof(args), "\"frames\":%d", event.value);
+            writeEvent(out, first, name, "i", us, args);
+            break;
+        case kTraceDropped:
+            std::fprintf(stderr, "Warning: %d events were dropped while recording\n", event.value);
+            us = lastUs;
+            break;
+        default:
+            writeEvent(out, first, name, "i", us, nullptr);
+            break;
+        }
+
+        lastUs = us;
+    }
+
+    if (gliding)
+        writeEvent(out, first, "glide", "E", lastUs, nullptr);
+
+    std::fprintf(out, "\n]}\n");
+
+    std::fclose(in);
+    if (out != stdout)
+        std::fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,400 @@
+/*
+ * Check a collection of .scl and .kbm files with the same parser the plugin uses (Tunings::readSCLFile and
+ * readKBMFile), before taking them on stage. Files are parsed on a pool of threads, one per core by default.
+ *
+ * Every problem found is written to stdout as one JSON object per line, followed by a summary line:
+ *   {"file":"a/b.scl","check":"parse","severity":"error","message":"..."}
+ *   {"summary":{"files":512,"scl":480,"kbm":32,"errors":1,"warnings":3,"seconds":0.214}}
+ *
+ * Checks:
+ *   parse       the file does not load; the plugin would reset that slot to the standard tuning
+ *   duplicate   a scale has the same tones as an earlier one (by path), whatever its comments and description
+ *   size        a .kbm does not fit the scale it goes with: its octave degrees differ from the scale's note count,
+ *               or it maps keys to degrees the scale does not have. A .kbm goes with the .scl of the same name in
+ *               the same folder, or with the only .scl in its folder
+ *   range       a note's frequency is not a number, or outside --min-hz to --max-hz (an error if not a number or
+ *               not above 0 Hz, otherwise a warning)
+ *
+ * Usage: scalesequence-validate-tunings [--jobs <n>] [--min-hz <n>] [--max-hz <n>] [--verbose] <folder or file>...
+ *   --verbose also writes a line for each file that passed.
+ * The exit code is 1 if any error was found, so it can be used as a pre-flight check.
+ */
+
+#include "Tunings.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Problem
+{
+    std::string check;
+    bool error;
+    std::string message;
+};
+
+struct TuningFile
+{
+    fs::path path;
+    bool kbm = false;
+    bool parsed = false;
+    Tunings::Scale scale;
+    Tunings::KeyboardMapping mapping;
+    uint64_t hash = 0;              // scales only: hash of the tones
+    const TuningFile* pair = nullptr; // mappings only: the scale it is checked against
+    std::vector<Problem> problems;
+};
+
+static double minHz = 1.0;
+static double maxHz = 24000.0;
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static std::string lowerExtension(const fs::path& path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return ext;
+}
+
+static void hashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    // FNV-1a
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= static_cast<const uint8_t*>(data)[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+/**
+   Hash of what the scale sounds like: its tones in cents, rounded to 1/10000 cent, so 3/2 and 701.955 match.
+ */
+static uint64_t hashScale(const Tunings::Scale& scale)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const Tunings::Tone& tone : scale.tones)
+    {
+        const int64_t cents = std::llround(tone.cents * 10000.0);
+        hashBytes(hash, &cents, sizeof(cents));
+    }
+    return hash;
+}
+
+static std::string jsonString(const std::string& text)
+{
+    std::string out("\"");
+    for (const char c : text)
+    {
+        switch (c)
+        {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else
+                out += c;
+            break;
+        }
+    }
+    return out + "\"";
+}
+
+static std::string formatHz(double hz)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.4f", hz);
+    return text;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+/**
+   Check the 128 notes of a tuning. @a what names the tuning in the message.
+ */
+static void checkRange(TuningFile& file, const Tunings::Tuning& tuning, const std::string& what)
+{
+    int32_t bad = 0, first = -1;
+    bool error = false;
+    double firstHz = 0.0;
+
+    for (int32_t note = 0; note < 128; note++)
+    {
+        const double hz = tuning.frequencyForMidiNote(note);
+        if (std::isfinite(hz) && hz >= minHz && hz <= maxHz)
+            continue;
+
+        if (bad++ == 0)
+        {
+            first = note;
+            firstHz = hz;
+        }
+        if (!std::isfinite(hz) || hz <= 0.0)
+            error = true;
+    }
+
+    if (bad > 0)
+        file.problems.push_back({ "range", error, std::to_string(bad) + " notes of " + what + " are out of range, first note "
+                                  + std::to_string(first) + " at " + formatHz(firstHz) + " Hz" });
+}
+
+/**
+   Parse one file. Runs on the pool threads, touching nothing but @a file.
+ */
+static void parse(TuningFile& file)
+{
+    try
+    {
+        if (file.kbm)
+            file.mapping = Tunings::readKBMFile(file.path.string());
+        else
+            file.scale = Tunings::readSCLFile(file.path.string());
+        file.parsed = true;
+    }
+    catch (const std::exception& e)
+    {
+        file.problems.push_back({ "parse", true, e.what() });
+        return;
+    }
+
+    if (file.kbm)
+        return;
+
+    file.hash = hashScale(file.scale);
+
+    try
+    {
+        checkRange(file, Tunings::Tuning(file.scale), "the scale on the standard mapping");
+    }
+    catch (const std::exception& e)
+    {
+        file.problems.push_back({ "parse", true, std::string("Not usable as a tuning: ") + e.what() });
+    }
+}
+
+/**
+   Check a mapping against its scale. Runs on the pool threads, after every file is parsed.
+ */
+static void checkPair(TuningFile& kbm)
+{
+    const TuningFile& scl = *kbm.pair;
+    const std::string sclName = scl.path.filename().string();
+    const int32_t notes = scl.scale.count;
+
+    // A map size of 0 is the linear mapping, which fits any scale
+    if (kbm.mapping.count > 0 && kbm.mapping.octaveDegrees != notes)
+        kbm.problems.push_back({ "size", false, "Octave degree " + std::to_string(kbm.mapping.octaveDegrees) + " but "
+                                 + sclName + " has " + std::to_string(notes) + " notes" });
+
+    int32_t highest = -1;
+    for (const int32_t key : kbm.mapping.keys)
+        highest = std::max(highest, key);
+    if (highest >= notes)
+        kbm.problems.push_back({ "size", false, "Maps a key to degree " + std::to_string(highest) + " but "
+                                 + sclName + " has " + std::to_string(notes) + " notes" });
+
+    try
+    {
+        checkRange(kbm, Tunings::Tuning(scl.scale, kbm.mapping), "the mapping with " + sclName);
+    }
+    catch (const std::exception& e)
+    {
+        kbm.problems.push_back({ "size", true, "Does not work with " + sclName + ": " + e.what() });
+    }
+}
+
+/**
+   Call @a work(i) for every i below @a count on @a jobs threads.
+ */
+template <typename Work>
+static void runPool(size_t count, uint32_t jobs, Work work)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+            work(i);
+    };
+
+    std::vector<std::thread> pool;
+    for (uint32_t i = 1; i < std::min<size_t>(jobs, count); i++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool)
+        t.join();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static bool parseDouble(const char* text, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+static int usage(const char* name, const char* error = nullptr)
+{
+    if (error != nullptr)
+        std::fprintf(stderr, "%s\n", error);
+    std::fprintf(stderr, "Usage: %s [--jobs <n>] [--min-hz <n>] [--max-hz <n>] [--verbose] <folder or file>...\n", name);
+    return 2;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<fs::path> roots;
+    uint32_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        double number = 0.0;
+
+        if (arg == "--jobs" && hasValue && parseDouble(argv[i + 1], number) && number >= 1.0)
+        {
+            jobs = static_cast<uint32_t>(number);
+            ++i;
+        }
+        else if (arg == "--min-hz" && hasValue && parseDouble(argv[i + 1], minHz))
+            ++i;
+        else if (arg == "--max-hz" && hasValue && parseDouble(argv[i + 1], maxHz))
+            ++i;
+        else if (arg == "--verbose")
+            verbose = true;
+        else if (arg.size() > 1 && arg[0] == '-')
+            return usage(argv[0], ("Bad option: " + arg).c_str());
+        else
+            roots.push_back(arg);
+    }
+
+    if (roots.empty())
+        return usage(argv[0], "No folders or files given");
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // Find the files, sorted so the output and "earlier" duplicates do not depend on the folder order
+    std::vector<TuningFile> files;
+    auto addFile = [&](const fs::path& path) {
+        const std::string ext = lowerExtension(path);
+        if (ext != ".scl" && ext != ".kbm")
+            return;
+        files.emplace_back();
+        files.back().path = path;
+        files.back().kbm = ext == ".kbm";
+    };
+
+    for (const fs::path& root : roots)
+    {
+        std::error_code ec;
+        if (fs::is_regular_file(root, ec))
+        {
+            addFile(root);
+            continue;
+        }
+        if (!fs::is_directory(root, ec))
+        {
+            std::fprintf(stderr, "Could not open %s\n", root.string().c_str());
+            return 2;
+        }
+        for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+             it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (ec)
+                break;
+            if (it->is_regular_file(ec))
+                addFile(it->path());
+        }
+    }
+
+    std::sort(files.begin(), files.end(), [](const TuningFile& a, const TuningFile& b) { return a.path < b.path; });
+    files.erase(std::unique(files.begin(), files.end(), [](const TuningFile& a, const TuningFile& b) { return a.path == b.path; }), files.end());
+
+    runPool(files.size(), jobs, [&](size_t i) { parse(files[i]); });
+
+    // Duplicates and pairs need every file, so they are found here, after the parse
+    std::map<uint64_t, const TuningFile*> firstWithHash;
+    std::map<fs::path, std::vector<const TuningFile*>> scalesInFolder;
+    for (TuningFile& file : files)
+    {
+        if (file.kbm || !file.parsed)
+            continue;
+
+        const auto first = firstWithHash.emplace(file.hash, &file);
+        if (!first.second)
+            file.problems.push_back({ "duplicate", false, "Same tones as " + first.first->second->path.string() });
+        scalesInFolder[file.path.parent_path()].push_back(&file);
+    }
+
+    std::vector<size_t> pairs;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        TuningFile& file = files[i];
+        if (!file.kbm || !file.parsed)
+            continue;
+
+        const auto folder = scalesInFolder.find(file.path.parent_path());
+        if (folder == scalesInFolder.end())
+            continue;
+        for (const TuningFile* scl : folder->second)
+            if (scl->path.stem() == file.path.stem())
+                file.pair = scl;
+        if (file.pair == nullptr && folder->second.size() == 1)
+            file.pair = folder->second.front();
+        if (file.pair != nullptr)
+            pairs.push_back(i);
+    }
+
+    runPool(pairs.size(), jobs, [&](size_t i) { checkPair(files[pairs[i]]); });
+
+    // Report
+    uint32_t sclCount = 0, errors = 0, warnings = 0;
+    for (const TuningFile& file : files)
+    {
+        const std::string path = jsonString(file.path.string());
+        sclCount += file.kbm ? 0 : 1;
+
+        for (const Problem& problem : file.problems)
+        {
+            std::printf("{\"file\":%s,\"check\":\"%s\",\"severity\":\"%s\",\"message\":%s}\n", path.c_str(), problem.check.c_str(),
+                        problem.error ? "error" : "warning", jsonString(problem.message).c_str());
+            (problem.error ? errors : warnings)++;
+        }
+
+        if (verbose && file.problems.empty())
+        {
+            if (file.kbm)
+                std::printf("{\"file\":%s,\"check\":\"ok\",\"type\":\"kbm\",\"size\":%d,\"scale\":%s}\n", path.c_str(), file.mapping.count,
+                            file.pair != nullptr ? jsonString(file.pair->path.string()).c_str() : "null");
+            else
+                std::printf("{\"file\":%s,\"check\":\"ok\",\"type\":\"scl\",\"notes\":%d,\"hash\":\"%016llx\"}\n", path.c_str(), file.scale.count,
+                            static_cast<unsigned long long>(file.hash));
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::printf("{\"summary\":{\"files\":%u,\"scl\":%u,\"kbm\":%u,\"errors\":%u,\"warnings\":%u,\"jobs\":%u,\"seconds\":%.3f}}\n",
+                static_cast<uint32_t>(files.size()), sclCount, static_cast<uint32_t>(files.size()) - sclCount, errors, warnings, jobs, elapsed);
+
+    return errors > 0 ? 1 : 0;
+}